@@ -0,0 +1,73 @@
+#define TESTS
+#define COUNT_ALLOCATIONS
+#include "../Main/Main.cpp"
+#include "../Test/Maps.h"
+#include "../Test/MapGenerator.h"
+#include "../Test/ThreadPool.h"
+#include "Batch.h"
+
+// Headless simulations of the games read from a file or stdin, or generated, one JSON line per game on stdout
+// Usage: Batch [--maps=path | --generate=count [--seed=seed]] [--threads=count] [--pin] [name=value | configuration file]...
+
+int main(int argc, char** argv)
+{
+	Config config;
+	config.m_simulation = true;
+	std::string mapsPath;
+	std::uint64_t generatedCount = 0, seed = 0;
+	Count threadsCount = std::max(std::thread::hardware_concurrency(), 1u);
+	bool pinThreads = false;
+	std::vector<char const*> configArguments = { argv[0] };
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string argument = argv[arg];
+		if (argument.rfind("--maps=", 0) == 0)
+			mapsPath = argument.substr(7);
+		else if (argument.rfind("--generate=", 0) == 0)
+			generatedCount = std::strtoull(argument.c_str() + 11, nullptr, 10);
+		else if (argument.rfind("--seed=", 0) == 0)
+			seed = std::strtoull(argument.c_str() + 7, nullptr, 10);
+		else if (argument.rfind("--threads=", 0) == 0)
+			threadsCount = static_cast<Count>(std::max(std::atoi(argument.c_str() + 10), 1));
+		else if (argument == "--pin")
+			pinThreads = true;
+		else
+			configArguments.push_back(argv[arg]);
+	}
+	if (!readConfig(static_cast<int>(configArguments.size()), configArguments.data(), config, std::cerr))
+		return 1;
+
+	std::ifstream mapsFile;
+	if (!mapsPath.empty())
+	{
+		mapsFile.open(mapsPath);
+		if (!mapsFile)
+		{
+			std::cerr << "Invalid maps file: " << mapsPath << std::endl;
+			return 1;
+		}
+	}
+	bool valid = true;
+	Count gamesCount = 0;
+	{
+		ThreadPool pool(threadsCount, pinThreads);
+		BatchRunner runner(config, pool, std::cout, 4 * threadsCount);
+		if (generatedCount)
+		{
+			for (std::uint64_t game = 0; game < generatedCount; ++game)
+			{
+				auto input = generateMap(seed, game);
+				runner.submit(game, input.m_checkpoints + input.m_initialState);
+			}
+			runner.wait();
+		}
+		else
+			gamesCount = runner.run(mapsPath.empty() ? std::cin : mapsFile, valid);
+	}
+	if (!valid)
+	{
+		std::cerr << "Invalid game after " << gamesCount << " games" << std::endl;
+		return 1;
+	}
+	return 0;
+}
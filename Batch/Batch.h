@@ -0,0 +1,96 @@
+#pragma once
+
+// Needs the definitions of Main.cpp and ThreadPool.h
+
+// Next game of is in the input format of the bot: the checkpoints count, the checkpoints and the initial state, one per line
+// Empty lines before a game are skipped, false at the end of is or on a truncated game
+static bool readGameInput(std::istream& is, std::string& gameInput)
+{
+	gameInput.clear();
+	std::string line;
+	while (std::getline(is, line) && line.find_first_not_of(" \t\r") == std::string::npos)
+		;
+	if (!is)
+		return false;
+	int checkpointsCount = 0;
+	if (!(std::istringstream(line) >> checkpointsCount) || checkpointsCount <= 0)
+		return false;
+	gameInput = line + "\n";
+	for (int lineIndex = 0; lineIndex <= checkpointsCount; ++lineIndex)
+	{
+		if (!std::getline(is, line))
+			return false;
+		gameInput += line + "\n";
+	}
+	return true;
+}
+
+// One JSON object per line, the counters other than the allocations stay at zero unless the games are instrumented
+static void writeJsonRecord(std::ostream& os, Index game, Result const& result)
+{
+	os << std::defaultfloat << std::setprecision(6) << "{\"game\":" << game << ",\"iterations\":" << result.m_iterationsCount << ",\"collisionTime\":" << result.m_collisionTime
+		<< ",\"testsCount\":" << result.m_testsCount << ",\"randomImprovementsCount\":" << result.m_randomImprovementsCount
+		<< ",\"mutationImprovementsCount\":" << result.m_mutationImprovementsCount << ",\"elapsed\":" << result.m_elpased;
+	auto const& gameCounters = result.m_counters;
+	os << ",\"counters\":{\"moves\":" << gameCounters.m_movesCount << ",\"directCommands\":" << gameCounters.m_directCommandsCount << ",\"forcedCommands\":" << gameCounters.m_forcedCommandsCount
+		<< ",\"boundAborts\":" << gameCounters.m_boundAbortsCount << ",\"prunedRollouts\":" << gameCounters.m_prunedRolloutsCount << ",\"allocations\":" << gameCounters.m_allocationsCount
+		<< ",\"generationNs\":" << gameCounters.m_generationDuration.count() << ",\"simulationNs\":" << gameCounters.m_simulationDuration.count() << "}}" << std::endl;
+}
+
+// Games read one by one and run as jobs of the pool, at most m_pendingMax of them at a time so that the input is streamed too
+// Records are written as the games end, in that order, their game index being their rank in the input
+struct BatchRunner
+{
+	BatchRunner(Config const& config, ThreadPool& pool, std::ostream& os, Count pendingMax)
+		: m_config(config), m_pool(pool), m_os(os), m_pendingMax(std::max(pendingMax, 1u))
+	{}
+
+	Config m_config;
+	ThreadPool& m_pool;
+	std::ostream& m_os;
+	Count m_pendingMax;
+	std::mutex m_mutex;
+	std::condition_variable m_ended;
+	Count m_pendingCount = 0u;
+
+	// Number of the games read, false in valid when the input ends on a truncated game
+	Count run(std::istream& is, bool& valid)
+	{
+		Count gamesCount = 0;
+		std::string gameInput;
+		while (readGameInput(is, gameInput))
+			submit(gamesCount++, gameInput);
+		valid = is.eof() && gameInput.empty();
+		wait();
+		return gamesCount;
+	}
+
+	// Waits for a place among the pending games
+	void submit(Index game, std::string gameInput)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_ended.wait(lock, [this]() { return m_pendingCount < m_pendingMax; });
+			++m_pendingCount;
+		}
+		m_pool.submit([this, game, gameInput = std::move(gameInput)]() { runGame(game, gameInput); });
+	}
+
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_ended.wait(lock, [this]() { return !m_pendingCount; });
+	}
+
+	void runGame(Index game, std::string const& gameInput)
+	{
+		std::istringstream in(gameInput);
+		std::ostringstream out;
+		IO io{ in, std::cerr, out };
+		auto result = ::runGame(m_config, io);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		writeJsonRecord(m_os, game, result);
+		--m_pendingCount;
+		m_ended.notify_all();
+	}
+};
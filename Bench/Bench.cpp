@@ -0,0 +1,191 @@
+#define TESTS
+#define COUNT_ALLOCATIONS
+#include "../Main/Main.cpp"
+#include "../Test/Maps.h"
+#include "../Test/MapGenerator.h"
+#include "../Test/TraceReader.h"
+
+// Microbenchmarks of the physics, the controllers and the search operators
+// Usage: Bench [milliseconds per benchmark] [generated maps count]
+//        Bench --replay=trace path [turn] [milliseconds]
+// Samples are taken on the built-in maps, or on the given count of generated maps
+// A replay runs the search of a traced turn, by default the slowest one, again and again for the profilers
+
+// Accumulates every result so that the timed calls are not optimized away
+static double checksum = 0.;
+
+// A state met by the direct controller on a map, with a random sequence to roll out from it
+struct Sample
+{
+	Game const* m_game = nullptr;
+	State m_state;
+	CompactState m_compactState;
+	Command m_command;
+	TestSequences m_testSequences;
+	Step m_targetStep = 0;
+};
+
+// Games of the maps, their states along the direct controller's race are the samples
+struct Samples
+{
+	Samples(IO& io, Config const& config, Random& random, std::vector<GameInput> const& inputs)
+	{
+		m_games.reserve(inputs.size());
+		for (auto const& input : inputs)
+		{
+			std::istringstream in(input.m_checkpoints + input.m_initialState);
+			IO inputIO{ in, io.m_err, io.m_out };
+			m_games.push_back({ config, Checkpoints::read(inputIO, config) });
+			auto const& game = m_games.back();
+			auto state = State::read(inputIO);
+			auto stepsCount = game.m_checkpoints.m_checkpoints.size();
+			while (state.m_step < stepsCount && state.m_iteration < iterationLimit)
+			{
+				auto command = getDirectCommand(game, io, state, config.m_speedFactor);
+				m_samples.push_back({ &game, state, CompactState(state), command, getRandomTestSequences(game, random), game.m_checkpoints.m_targetSteps[state.m_step] });
+				state = command.move(game, state);
+			}
+		}
+	}
+
+	std::vector<Game> m_games;
+	std::vector<Sample> m_samples;
+};
+
+// Calls operation on every sample until duration has elapsed, returns the nanoseconds per call
+template<typename Operation>
+static double timeOperation(std::vector<Sample> const& samples, std::chrono::milliseconds duration, Operation&& operation)
+{
+	Count operationsCount = 0;
+	auto startTimePoint = now();
+	auto limitTimePoint = startTimePoint + duration;
+	do
+	{
+		for (auto const& sample : samples)
+			checksum += operation(sample);
+		operationsCount += samples.size();
+	} while (now() < limitTimePoint);
+	return std::chrono::duration<double, std::nano>(now() - startTimePoint).count() / operationsCount;
+}
+
+// Searches of a few milliseconds spread over the samples, the way a turn runs them: its rollouts per millisecond calibrate m_rolloutsPerMillisecond
+static double getSearchRolloutNanoseconds(IO& io, std::vector<Sample> const& samples, std::chrono::milliseconds duration, Random& random)
+{
+	auto const searchDuration = std::chrono::milliseconds(2);
+	Count searchesCount = std::max(static_cast<Count>(duration / searchDuration), 1u);
+	Count testsCount = 0;
+	auto startTimePoint = now();
+	for (Index search = 0; search < searchesCount; ++search)
+	{
+		auto const& sample = samples[search * samples.size() / searchesCount];
+		SearchSlot slot;
+		slot.m_best = reachNext(io, *sample.m_game, StepIteration(), sample.m_targetStep, sample.m_state, slot.m_bestTestSequences);
+		searchTestSequences(io, *sample.m_game, random, sample.m_state, sample.m_targetStep, slot.m_bestTestSequences, now() + searchDuration, slot);
+		testsCount += slot.m_testsCount;
+		checksum += slot.m_best.m_iteration;
+	}
+	return std::chrono::duration<double, std::nano>(now() - startTimePoint).count() / testsCount;
+}
+
+static void report(std::ostream& os, std::string const& name, double nanoseconds)
+{
+	os << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(1) << std::setw(12) << nanoseconds << " ns/op" << std::endl;
+}
+
+static void reportRollouts(std::ostream& os, std::string const& name, double nanoseconds)
+{
+	os << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(1) << std::setw(12) << nanoseconds << " ns/op"
+		<< std::setprecision(0) << std::setw(12) << 1e9 / nanoseconds << " rollouts/s" << std::endl;
+}
+
+static int replayTrace(std::string const& path, char const* turnArgument, std::chrono::milliseconds duration)
+{
+	TraceReader trace(path);
+	if (!trace.isValid() || !trace.getRecordsCount())
+	{
+		std::cerr << "Invalid trace: " << path << std::endl;
+		return 1;
+	}
+	Index turn = 0;
+	if (turnArgument)
+		turn = std::min(static_cast<Index>(std::atoi(turnArgument)), static_cast<Index>(trace.getRecordsCount() - 1));
+	else
+		for (Index other = 1; other < trace.getRecordsCount(); ++other)
+			if (trace.getRecord(other).m_elapsed > trace.getRecord(turn).m_elapsed)
+				turn = other;
+	std::ostringstream err, out;
+	IO io{ std::cin, err, out };
+	auto game = trace.getGame(io, trace.m_config);
+	auto const& record = trace.getRecord(turn);
+	std::cout << "turn " << turn << " of " << trace.getRecordsCount() << ": elapsed=" << std::fixed << std::setprecision(3) << record.m_elapsed / 1e6 << "ms testsCount=" << record.m_testsCount
+		<< " bestIteration: " << record.m_bestIteration << std::endl;
+	Count replaysCount = 0;
+	SearchSlot slot;
+	auto startTimePoint = std::chrono::steady_clock::now();
+	do
+	{
+		slot = replayTurn(io, game, record);
+		++replaysCount;
+	} while (std::chrono::steady_clock::now() < startTimePoint + duration);
+	auto replayNanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTimePoint).count() / replaysCount;
+	std::cout << "replaysCount=" << replaysCount << " elapsed=" << replayNanoseconds / 1e6 << "ms testsCount=" << slot.m_testsCount << " bestIteration: " << slot.m_best << std::endl;
+	reportRollouts(std::cout, "replayTurn", replayNanoseconds / std::max(slot.m_testsCount, 1u));
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::string(argv[1]).rfind("--replay=", 0) == 0)
+		return replayTrace(argv[1] + 9, argc > 2 ? argv[2] : nullptr, std::chrono::milliseconds(argc > 3 ? std::atoi(argv[3]) : 1000));
+	std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 200);
+	Count generatedCount = argc > 2 ? static_cast<Count>(std::atoi(argv[2])) : 0u;
+	auto inputs = gameInputs;
+	if (generatedCount)
+	{
+		inputs.clear();
+		for (Index map = 0; map < generatedCount; ++map)
+			inputs.push_back(generateMap(0u, map));
+	}
+	Config config;
+	config.m_simulation = true;
+	std::ostringstream err, out;
+	IO io{ std::cin, err, out };
+	Random random;
+	Samples samples(io, config, random, inputs);
+	auto const& s = samples.m_samples;
+	std::cout << s.size() << " samples from " << samples.m_games.size() << " maps, " << duration.count() << "ms per benchmark" << std::endl;
+
+	using Version0Policy = StaticPolicy<0, true, true, RunLevel::Release>;
+	using Version1Policy = StaticPolicy<1, true, true, RunLevel::Release>;
+
+	report(std::cout, "Command::move", timeOperation(s, duration, [](Sample const& sample)
+		{ return sample.m_command.move(*sample.m_game, sample.m_state).m_position.real(); }));
+	report(std::cout, "Command::move (compact)", timeOperation(s, duration, [](Sample const& sample)
+		{ double collisionTime; return sample.m_command.move(*sample.m_game, sample.m_compactState, collisionTime).m_x + collisionTime; }));
+	report(std::cout, "getCollisionTime", timeOperation(s, duration, [](Sample const& sample)
+		{ auto collisionTime = getCollisionTime(sample.m_state.m_position, sample.m_state.m_speed, sample.m_game->m_checkpoints.m_checkpoints[sample.m_state.m_step]); return std::abs(collisionTime) <= 1. ? collisionTime : 0.; }));
+	report(std::cout, "getDirectCommand v0", timeOperation(s, duration, [&io](Sample const& sample)
+		{ return getDirectCommand<Version0Policy>(*sample.m_game, io, sample.m_state, sample.m_game->m_config.m_speedFactor).m_angle; }));
+	report(std::cout, "getDirectCommand v1", timeOperation(s, duration, [&io](Sample const& sample)
+		{ return getDirectCommand<Version1Policy>(*sample.m_game, io, sample.m_state, sample.m_game->m_config.m_speedFactor).m_angle; }));
+	report(std::cout, "getDirectCommand2", timeOperation(s, duration, [&io](Sample const& sample)
+		{ return getDirectCommand2(*sample.m_game, io, sample.m_state).m_angle; }));
+	report(std::cout, "isOutDisksOfRotation", timeOperation(s, duration, [](Sample const& sample)
+		{ return isOutDisksOfRotation(sample.m_state.m_position, sample.m_state.m_speed, sample.m_game->m_checkpoints.m_checkpoints[sample.m_state.m_step], checkpointRadius) ? 1. : 0.; }));
+	report(std::cout, "popCommand", timeOperation(s, duration, [&io](Sample const& sample)
+		{ TestSequencesCursor cursor{ &sample.m_testSequences }; return popCommand(cursor, *sample.m_game, io, sample.m_compactState).m_angle; }));
+	report(std::cout, "mutateTestSequences", timeOperation(s, duration, [&random](Sample const& sample)
+		{ Index firstChange; return static_cast<double>(mutateTestSequences(*sample.m_game, random, sample.m_testSequences, firstChange).size() + firstChange); }));
+	report(std::cout, "getRandomTestSequences", timeOperation(s, duration, [&random](Sample const& sample)
+		{ return static_cast<double>(getRandomTestSequences(*sample.m_game, random).size()); }));
+	reportRollouts(std::cout, "reachNext", timeOperation(s, duration, [&io](Sample const& sample)
+		{ return static_cast<double>(reachNext(io, *sample.m_game, StepIteration(), sample.m_targetStep, sample.m_state, sample.m_testSequences).m_iteration); }));
+	reportRollouts(std::cout, "reachNext (ReleasePolicy)", timeOperation(s, duration, [&io](Sample const& sample)
+		{ return static_cast<double>(reachNext<ReleasePolicy>(io, *sample.m_game, StepIteration(), sample.m_targetStep, sample.m_state, sample.m_testSequences).m_iteration); }));
+
+	auto searchRolloutNanoseconds = getSearchRolloutNanoseconds(io, s, duration, random);
+	reportRollouts(std::cout, "searchTestSequences", searchRolloutNanoseconds);
+	std::cout << "rolloutsPerMillisecond=" << std::fixed << std::setprecision(0) << 1e6 / searchRolloutNanoseconds << std::endl;
+
+	std::cout << "checksum=" << checksum << std::endl;
+}
@@ -1,23 +1,49 @@
 #include <chrono>
+#include <string>
 
 enum class RunLevel { Debug = 0, Test = 1, PreValidation = 2, Validation = 3, Release = 4 };
+enum class SearchEngine { Sampling = 0, Evolution = 1, Beam = 2 };
 
 struct Config
 {
 	bool m_simulation = false;
 	std::chrono::milliseconds m_stepTime = std::chrono::milliseconds(40);
 	std::chrono::milliseconds m_firstStepTime = std::chrono::milliseconds(950);
+	unsigned m_rolloutsPerMillisecond = 0;
 	RunLevel m_runLevel = RunLevel::Release;
+	std::string m_tracePath = {};
+	bool m_instrument = false;
 
 	bool m_withRandomTests = true;
+	unsigned m_seed = 0;
 	unsigned m_testSequencesSizeMax = 3;
 	unsigned m_testSequenceIterationsMax = 5;
 	unsigned m_targetStep = 2;
 	double m_targetDistance = 2000.;
 	double m_speedFactor = 3.5;
+	bool m_asyncLog = true;
 	bool m_useDisksOfRotation = true;
 	unsigned m_directCommandVersion = 0;
 	double m_radiusFactor = .5;
+	unsigned m_rolloutsBatchSize = 8;
+	unsigned m_searchThreadsCount = 1;
+	bool m_pruneRollouts = true;
+	unsigned m_deadlineCheckInterval = 16;
+	bool m_planRace = false;
+	bool m_adaptiveBudget = false;
+	std::chrono::milliseconds m_budgetMargin = std::chrono::milliseconds(5);
+	double m_transitionBudgetFactor = 1.125;
+	double m_stableBudgetFactor = .6;
+	unsigned m_transitionTurns = 3;
+	unsigned m_stableTurns = 3;
+	unsigned m_rolloutHorizon = 0;
+	unsigned m_costToGoSteps = 2;
+	SearchEngine m_searchEngine = SearchEngine::Sampling;
+	unsigned m_populationSize = 64;
+	unsigned m_eliteSize = 16;
+	unsigned m_tournamentSize = 3;
+	unsigned m_beamWidth = 192;
+	double m_beamSpeed = 250.;
 
 	Config()
 	{
@@ -33,25 +59,62 @@ struct Config
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <charconv>
 #include <cmath>
 #include <complex>
-#include <deque>
+#include <condition_variable>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <limits>
 #include <cmath> 
+#include <memory>
+#include <mutex>
+#include <new>
 #include <numeric>
-#include <random>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 #define doAtLevel(game, runLevel) if (game.m_config.m_runLevel <= runLevel)
 #define logAtLevel(game, runLevel, io) doAtLevel(game, runLevel) io.m_err
+#define logRecordAtLevel(game, runLevel, io, ...) doAtLevel(game, runLevel) io.logRecord(__VA_ARGS__)
 #define assertAtLevel(game, runLevel, expression) doAtLevel(game, runLevel) assert(expression)
+#define doAtPolicyLevel(Policy, game, runLevel) if (Policy::isAtLevel(game.m_config, runLevel))
+#define assertAtPolicyLevel(Policy, game, runLevel, expression) doAtPolicyLevel(Policy, game, runLevel) assert(expression)
+#define doIfInstrumented(Policy, game) if (Policy::instrument(game.m_config))
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+static bool hasAvx2()
+{
+	return __builtin_cpu_supports("avx2");
+}
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#define AVX2_TARGET
+static bool hasAvx2()
+{
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	return osxsave && (info[1] & (1 << 5));
+}
+#endif
 
 using namespace std::literals::complex_literals;
 
@@ -66,9 +129,9 @@ using Iteration = unsigned;
 using Milliseconds = unsigned;
 using Index = std::size_t;
 
-const double pi = 3.141592653589793238463;
-const double radByDeg = pi / 180.;
-const double degByRad = 180. / pi;
+constexpr double pi = 3.141592653589793238463;
+constexpr double radByDeg = pi / 180.;
+constexpr double degByRad = 180. / pi;
 const Distance epsilon = .00001;
 const Angle angleMax = 18;
 const double halfInverseTanHalfAngleMax = .5 / std::tan(.5 * angleMax * radByDeg);
@@ -79,6 +142,7 @@ const Distance xMax = 16000, yMax = 9000, checkpointRadius = 600;
 const double checkpointRadiusSquare = checkpointRadius * checkpointRadius;
 const double friction = .15;
 const Iteration iterationLimit = 600;
+const Count rolloutsBatchMax = 16;
 const std::chrono::milliseconds firstStepTime(1000);
 const std::chrono::milliseconds stepTime(50);
 Count lapsCount = 3;
@@ -104,8 +168,117 @@ static void transfer(Destination& destination, Source&& source, Args&&...args)
 
 using TimePoint = std::chrono::steady_clock::time_point;
 
+// Clock of a simulation thread counting rollouts instead of time, one millisecond every m_rolloutsPerMillisecond rollouts,
+// so that a search does the same work whatever the host and its load
+struct VirtualClock
+{
+	Count m_rolloutsPerMillisecond = 0u;
+	std::uint64_t m_rolloutsCount = 0u;
+
+	TimePoint getTimePoint() const
+	{
+		return TimePoint(std::chrono::duration_cast<TimePoint::duration>(std::chrono::duration<double, std::milli>(static_cast<double>(m_rolloutsCount) / m_rolloutsPerMillisecond)));
+	}
+};
+
+// Runs only while m_rolloutsPerMillisecond is set
+static thread_local VirtualClock virtualClock;
+
+// Work of the hot path on a thread, counted by the instrumented policies, and its allocations, counted by the builds defining COUNT_ALLOCATIONS
+// m_movesCount covers every Command::move of a turn, the direct runs of Checkpoints::fillCostsToGo happen before the first turn and are left out
+struct Counters
+{
+	std::uint64_t m_movesCount = 0u;
+	std::uint64_t m_directCommandsCount = 0u;
+	std::uint64_t m_forcedCommandsCount = 0u;
+	std::uint64_t m_boundAbortsCount = 0u;
+	std::uint64_t m_prunedRolloutsCount = 0u;
+	std::uint64_t m_allocationsCount = 0u;
+	std::chrono::nanoseconds m_generationDuration = {};
+	std::chrono::nanoseconds m_simulationDuration = {};
+};
+
+static Counters& operator+=(Counters& lhs, Counters const& rhs)
+{
+	lhs.m_movesCount += rhs.m_movesCount;
+	lhs.m_directCommandsCount += rhs.m_directCommandsCount;
+	lhs.m_forcedCommandsCount += rhs.m_forcedCommandsCount;
+	lhs.m_boundAbortsCount += rhs.m_boundAbortsCount;
+	lhs.m_prunedRolloutsCount += rhs.m_prunedRolloutsCount;
+	lhs.m_allocationsCount += rhs.m_allocationsCount;
+	lhs.m_generationDuration += rhs.m_generationDuration;
+	lhs.m_simulationDuration += rhs.m_simulationDuration;
+	return lhs;
+}
+
+static Counters operator-(Counters const& lhs, Counters const& rhs)
+{
+	return { lhs.m_movesCount - rhs.m_movesCount, lhs.m_directCommandsCount - rhs.m_directCommandsCount, lhs.m_forcedCommandsCount - rhs.m_forcedCommandsCount,
+		lhs.m_boundAbortsCount - rhs.m_boundAbortsCount, lhs.m_prunedRolloutsCount - rhs.m_prunedRolloutsCount, lhs.m_allocationsCount - rhs.m_allocationsCount,
+		lhs.m_generationDuration - rhs.m_generationDuration, lhs.m_simulationDuration - rhs.m_simulationDuration };
+}
+
+static thread_local Counters counters;
+
+// Adds the time of its scope to *duration, reads no clock without a duration
+struct ScopedTimer
+{
+	explicit ScopedTimer(std::chrono::nanoseconds* duration) : m_duration(duration)
+	{
+		if (m_duration)
+			m_start = std::chrono::steady_clock::now();
+	}
+
+	~ScopedTimer()
+	{
+		if (m_duration)
+			*m_duration += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+	}
+
+	std::chrono::nanoseconds* m_duration;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+template<typename F>
+static auto timeCall(std::chrono::nanoseconds* duration, F&& f)
+{
+	ScopedTimer timer(duration);
+	return f();
+}
+
+#ifdef COUNT_ALLOCATIONS
+// Allocations of the thread are counted by the replaced global allocation functions, the others forward to them
+void* operator new(std::size_t size)
+{
+	++counters.m_allocationsCount;
+	if (auto pointer = std::malloc(size ? size : 1u))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+// GCC takes the replaced operator new for the standard one and reports the free of its memory as mismatched
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+#endif
+
 static TimePoint now()
 {
+	if (virtualClock.m_rolloutsPerMillisecond)
+		return virtualClock.getTimePoint();
 	return std::chrono::steady_clock::now();
 }
 
@@ -114,6 +287,349 @@ static Milliseconds getMillisecondsElapsed(TimePoint const& start, TimePoint con
 	return static_cast<Milliseconds>(std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
 }
 
+// Calls visit(name, member) on each member of config, names are those of the configuration files and of the command line
+template<typename C, typename Visit>
+static void visitConfig(C& config, Visit&& visit)
+{
+	visit("simulation", config.m_simulation);
+	visit("stepTime", config.m_stepTime);
+	visit("firstStepTime", config.m_firstStepTime);
+	visit("rolloutsPerMillisecond", config.m_rolloutsPerMillisecond);
+	visit("runLevel", config.m_runLevel);
+	visit("tracePath", config.m_tracePath);
+	visit("instrument", config.m_instrument);
+	visit("withRandomTests", config.m_withRandomTests);
+	visit("seed", config.m_seed);
+	visit("testSequencesSizeMax", config.m_testSequencesSizeMax);
+	visit("testSequenceIterationsMax", config.m_testSequenceIterationsMax);
+	visit("targetStep", config.m_targetStep);
+	visit("targetDistance", config.m_targetDistance);
+	visit("speedFactor", config.m_speedFactor);
+	visit("asyncLog", config.m_asyncLog);
+	visit("useDisksOfRotation", config.m_useDisksOfRotation);
+	visit("directCommandVersion", config.m_directCommandVersion);
+	visit("radiusFactor", config.m_radiusFactor);
+	visit("rolloutsBatchSize", config.m_rolloutsBatchSize);
+	visit("searchThreadsCount", config.m_searchThreadsCount);
+	visit("pruneRollouts", config.m_pruneRollouts);
+	visit("deadlineCheckInterval", config.m_deadlineCheckInterval);
+	visit("planRace", config.m_planRace);
+	visit("adaptiveBudget", config.m_adaptiveBudget);
+	visit("budgetMargin", config.m_budgetMargin);
+	visit("transitionBudgetFactor", config.m_transitionBudgetFactor);
+	visit("stableBudgetFactor", config.m_stableBudgetFactor);
+	visit("transitionTurns", config.m_transitionTurns);
+	visit("stableTurns", config.m_stableTurns);
+	visit("rolloutHorizon", config.m_rolloutHorizon);
+	visit("costToGoSteps", config.m_costToGoSteps);
+	visit("searchEngine", config.m_searchEngine);
+	visit("populationSize", config.m_populationSize);
+	visit("eliteSize", config.m_eliteSize);
+	visit("tournamentSize", config.m_tournamentSize);
+	visit("beamWidth", config.m_beamWidth);
+	visit("beamSpeed", config.m_beamSpeed);
+}
+
+// Booleans are 0, 1, false or true, durations are in milliseconds, enumerations are given by their value and strings are taken as they are
+template<typename T>
+static bool parseConfigValue(std::string const& text, T& value)
+{
+	std::istringstream is(text);
+	if constexpr (std::is_same_v<T, std::string>)
+	{
+		value = text;
+		return true;
+	}
+	else if constexpr (std::is_same_v<T, bool>)
+	{
+		if (text == "true" || text == "false")
+		{
+			value = text == "true";
+			return true;
+		}
+		int number = 0;
+		is >> number;
+		value = number != 0;
+	}
+	else if constexpr (std::is_enum_v<T>)
+	{
+		std::underlying_type_t<T> number = {};
+		is >> number;
+		value = static_cast<T>(number);
+	}
+	else if constexpr (std::is_same_v<T, std::chrono::milliseconds>)
+	{
+		std::chrono::milliseconds::rep count = 0;
+		is >> count;
+		value = std::chrono::milliseconds(count);
+	}
+	else
+		is >> value;
+	return is && (is >> std::ws).eof();
+}
+
+template<typename T>
+static void writeConfigValue(std::ostream& os, T const& value)
+{
+	if constexpr (std::is_enum_v<T>)
+		os << static_cast<std::underlying_type_t<T>>(value);
+	else if constexpr (std::is_same_v<T, std::chrono::milliseconds>)
+		os << value.count();
+	else if constexpr (std::is_floating_point_v<T>)
+		os << std::defaultfloat << std::setprecision(10) << value;
+	else
+		os << value;
+}
+
+// False when name is not a member of Config or value does not parse, config is then left unchanged
+static bool setConfigValue(Config& config, std::string const& name, std::string const& value)
+{
+	bool set = false;
+	visitConfig(config, [&](char const* memberName, auto& member)
+		{
+			auto parsed = member;
+			if (!set && name == memberName && parseConfigValue(value, parsed))
+				transfer(member, parsed, set, true);
+		});
+	return set;
+}
+
+// One name=value line per member, as read by readConfig
+static std::ostream& operator<<(std::ostream& os, Config const& config)
+{
+	visitConfig(config, [&](char const* memberName, auto const& member)
+		{
+			os << memberName << "=";
+			writeConfigValue(os, member);
+			os << std::endl;
+		});
+	return os;
+}
+
+// Text without its leading and trailing blanks
+static std::string trimBlanks(std::string const& text)
+{
+	auto first = text.find_first_not_of(" \t\r");
+	if (first == std::string::npos)
+		return {};
+	return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+// Blanks around the name and the value are dropped, those inside the value are kept
+static bool setConfigLine(Config& config, std::string const& line, std::ostream& err)
+{
+	auto separator = line.find('=');
+	if (separator != std::string::npos && setConfigValue(config, trimBlanks(line.substr(0, separator)), trimBlanks(line.substr(separator + 1))))
+		return true;
+	err << "Invalid configuration: " << line << std::endl;
+	return false;
+}
+
+// Lines name=value, empty lines and lines starting with # are skipped
+static bool readConfig(std::istream& is, Config& config, std::ostream& err)
+{
+	bool valid = true;
+	std::string line;
+	while (std::getline(is, line))
+	{
+		line = trimBlanks(line);
+		if (!line.empty() && line[0] != '#')
+			valid = setConfigLine(config, line, err) && valid;
+	}
+	return valid;
+}
+
+// Arguments name=value set a member, other arguments are configuration files read in turn
+static bool readConfig(int argc, char const* const* argv, Config& config, std::ostream& err)
+{
+	bool valid = true;
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string argument = argv[arg];
+		if (argument.find('=') != std::string::npos)
+		{
+			valid = setConfigLine(config, argument, err) && valid;
+			continue;
+		}
+		std::ifstream file(argument);
+		if (!file)
+		{
+			err << "Invalid configuration file: " << argument << std::endl;
+			valid = false;
+		}
+		else
+			valid = readConfig(file, config, err) && valid;
+	}
+	return valid;
+}
+
+// Single producer ring of log records drained into m_os by a background thread, so that logging threads neither format nor flush
+// A record holds trivially copyable values and the function formatting them, text written to m_stream is sent as text records
+// A full ring drops records rather than blocking the producer, the drained output reports how many
+struct AsyncLog
+{
+	using Formatter = void (*)(std::ostream&, char const*, std::size_t);
+	static constexpr std::size_t payloadSize = 240;
+
+	struct Record
+	{
+		Formatter m_format = nullptr;
+		std::size_t m_size = 0;
+		char m_payload[payloadSize];
+	};
+
+	// Text is gathered in the put area and sent at every flush, std::endl included
+	struct Buffer : std::streambuf
+	{
+		explicit Buffer(AsyncLog& log) : m_log(log)
+		{
+			setp(m_text.data(), m_text.data() + m_text.size());
+		}
+
+		int_type overflow(int_type c) override
+		{
+			sync();
+			if (!traits_type::eq_int_type(c, traits_type::eof()))
+			{
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
+			}
+			return traits_type::not_eof(c);
+		}
+
+		int sync() override
+		{
+			if (pptr() != pbase())
+				m_log.pushText(pbase(), static_cast<std::size_t>(pptr() - pbase()));
+			setp(m_text.data(), m_text.data() + m_text.size());
+			return 0;
+		}
+
+		AsyncLog& m_log;
+		std::array<char, payloadSize> m_text;
+	};
+
+	explicit AsyncLog(std::ostream& os, std::size_t capacityLog2 = 12)
+		: m_os(os), m_records(std::size_t(1) << capacityLog2), m_mask(m_records.size() - 1), m_buffer(*this), m_stream(&m_buffer)
+		, m_thread([this]() { drain(); })
+	{}
+
+	~AsyncLog()
+	{
+		m_stream.flush();
+		m_stop.store(true, std::memory_order_release);
+		m_thread.join();
+	}
+
+	template<typename T>
+	static void append(char*& payload, T const& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "log records hold trivially copyable values");
+		std::memcpy(payload, &value, sizeof(T));
+		payload += sizeof(T);
+	}
+
+	template<typename T>
+	static T extract(char const*& payload)
+	{
+		T value;
+		std::memcpy(&value, payload, sizeof(T));
+		payload += sizeof(T);
+		return value;
+	}
+
+	template<typename... Ts>
+	static void format(std::ostream& os, char const* payload, std::size_t)
+	{
+		((os << extract<Ts>(payload)), ...);
+		os << std::endl;
+	}
+
+	static void formatText(std::ostream& os, char const* payload, std::size_t size)
+	{
+		os.write(payload, static_cast<std::streamsize>(size));
+	}
+
+	// Arrays, string literals for instance, are stored as pointers, they have to outlive the drain
+	template<typename... Args>
+	void push(Args const&... args)
+	{
+		static_assert((sizeof(std::decay_t<Args const>) + ... + 0) <= payloadSize, "log record too large");
+		auto record = acquire();
+		if (!record)
+			return;
+		auto payload = record->m_payload;
+		(append<std::decay_t<Args const>>(payload, args), ...);
+		record->m_format = &format<std::decay_t<Args const>...>;
+		record->m_size = static_cast<std::size_t>(payload - record->m_payload);
+		publish();
+	}
+
+	void pushText(char const* text, std::size_t size)
+	{
+		auto record = acquire();
+		if (!record)
+			return;
+		std::memcpy(record->m_payload, text, size);
+		transfer(record->m_format, &formatText, record->m_size, size);
+		publish();
+	}
+
+	Record* acquire()
+	{
+		auto head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) == m_records.size())
+		{
+			m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		return &m_records[head & m_mask];
+	}
+
+	void publish()
+	{
+		m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	void drain()
+	{
+		std::size_t reportedCount = 0;
+		while (true)
+		{
+			auto stop = m_stop.load(std::memory_order_acquire);
+			auto head = m_head.load(std::memory_order_acquire);
+			auto tail = m_tail.load(std::memory_order_relaxed);
+			for (; tail != head; ++tail)
+			{
+				auto const& record = m_records[tail & m_mask];
+				record.m_format(m_os, record.m_payload, record.m_size);
+				m_tail.store(tail + 1, std::memory_order_release);
+			}
+			auto droppedCount = m_droppedCount.load(std::memory_order_relaxed);
+			if (droppedCount != reportedCount)
+			{
+				m_os << "log: " << droppedCount - reportedCount << " records dropped" << std::endl;
+				reportedCount = droppedCount;
+			}
+			m_os.flush();
+			if (stop)
+				return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	std::ostream& m_os;
+	std::vector<Record> m_records;
+	std::size_t m_mask;
+	std::atomic<std::size_t> m_head{ 0 };
+	std::atomic<std::size_t> m_tail{ 0 };
+	std::atomic<std::size_t> m_droppedCount{ 0 };
+	std::atomic<bool> m_stop{ false };
+	Buffer m_buffer;
+	std::ostream m_stream;
+	std::thread m_thread;
+};
+
 struct IO
 {
 	static IO make()
@@ -121,34 +637,71 @@ struct IO
 		return { std::cin, std::cerr, std::cout };
 	}
 
+	// Tokens are parsed in place from the current line, m_line and m_read keep their capacity from one turn to the next
 	template<typename T>
 	T read(bool end = false)
 	{
-		std::string s;
-		m_in >> s;
-		m_read << s << " ";
-		std::istringstream is(std::move(s));
-		T t;
-		is >> t;
+		auto token = readToken();
+		T t = {};
+		std::from_chars(token.data(), token.data() + token.size(), t);
+		if (m_echo)
+			m_read.append(token).append(" ");
 		if (end)
 		{
-			m_read << "\\n";
-			m_in.ignore();
+			if (m_echo)
+				m_read.append("\\n");
+			m_position = m_line.size();
 		}
 		return t;
 	}
 
+	std::string_view readToken()
+	{
+		while (true)
+		{
+			auto first = m_line.find_first_not_of(" \t\r", m_position);
+			if (first != std::string::npos)
+			{
+				m_position = std::min(m_line.find_first_of(" \t\r", first), m_line.size());
+				return std::string_view(m_line).substr(first, m_position - first);
+			}
+			m_position = 0;
+			if (!std::getline(m_in, m_line))
+			{
+				m_line.clear();
+				return {};
+			}
+			m_lineTimePoint = now();
+		}
+	}
+
+	// Values formatted one after the other on a line, by the background thread of m_log when there is one
+	template<typename... Args>
+	void logRecord(Args const&... args)
+	{
+		if (m_log)
+			m_log->push(args...);
+		else
+			((m_err << args), ...) << std::endl;
+	}
+
 	std::string getLastRead()
 	{
-		auto lastRead = m_read.str();
-		m_read.str("");
+		std::string lastRead(m_read);
+		m_read.clear();
 		return lastRead;
 	}
 
 	std::istream& m_in;
 	std::ostream& m_err;
 	std::ostream& m_out;
-	std::ostringstream m_read;
+	bool m_echo = true;
+	std::string m_read;
+	std::string m_line;
+	std::size_t m_position = 0;
+	// When m_line was received, before its tokens are parsed
+	TimePoint m_lineTimePoint = {};
+	AsyncLog* m_log = nullptr;
 };
 
 template<>
@@ -164,31 +717,68 @@ static const unsigned seed()
 	return seed;
 }
 
+// Counter-based generator: draw n of a stream is the SplitMix64 finalizer of key + n * gamma, so streams are independent and reproducible
+struct Random
+{
+	explicit Random(std::uint64_t seed = 0u, std::uint64_t stream = 0u) : m_key(mix(mix(seed) + stream))
+	{}
+
+	static std::uint64_t mix(std::uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	std::uint64_t next()
+	{
+		return mix(m_key + ++m_counter * 0x9e3779b97f4a7c15ull);
+	}
+
+	// Lemire's multiply and reject method, uniform over [0, range[ without the bias of a modulo
+	std::uint32_t getBelow(std::uint32_t range)
+	{
+		auto product = (next() >> 32) * range;
+		if (static_cast<std::uint32_t>(product) < range)
+		{
+			auto threshold = (0u - range) % range;
+			while (static_cast<std::uint32_t>(product) < threshold)
+				product = (next() >> 32) * range;
+		}
+		return static_cast<std::uint32_t>(product >> 32);
+	}
+
+	std::uint64_t m_key;
+	std::uint64_t m_counter = 0u;
+};
+
 template<typename T>
-static T getRandom(T min, T max)
+static T getRandom(Random& random, T min, T max)
 {
-	static std::default_random_engine generator(seed());
-	static std::uniform_int_distribution<T> distribution;
-	return min + distribution(generator) % (max - min + 1);
+	return static_cast<T>(min + static_cast<T>(random.getBelow(static_cast<std::uint32_t>(max - min) + 1u)));
 }
 
 template<typename T, T min, T max>
-static T getRandom()
+static T getRandom(Random& random)
 {
-	static std::default_random_engine generator(seed());
-	static std::uniform_int_distribution<T> distribution(min, max);
-	return distribution(generator);
+	return getRandom<T>(random, min, max);
 }
 
-static auto getRandomAngle = getRandom<Angle, -angleMax, +angleMax>;
-static auto getRandomThrust = getRandom<Thrust, 0, thrustMax>;
+static Angle getRandomAngle(Random& random)
+{
+	return getRandom<Angle, -angleMax, +angleMax>(random);
+}
+
+static Thrust getRandomThrust(Random& random)
+{
+	return getRandom<Thrust, 0, thrustMax>(random);
+}
 
 template<typename T, T tMin, T tMax>
 static T getAngle(T t)
 {
-	if (t < tMin) return getAngle<T, tMin, tMax>(t + tMax - tMin);
-	if (t < tMax) return t;
-	return getAngle<T, tMin, tMax>(t - tMax + tMin);
+	auto offset = (t - tMin) % (tMax - tMin);
+	return (offset < 0 ? offset + tMax - tMin : offset) + tMin;
 }
 
 template<typename T>
@@ -223,23 +813,173 @@ static auto getValidThrust = getValid<Thrust, 0, thrustMax>;
 static auto isValidAngle = isValid<Angle, -angleMax, +angleMax>;
 static auto isValidThrust = isValid<Thrust, 0, thrustMax>;
 
-static std::array<Z, 360> getPolarArray()
+// Unevaluated sum of two doubles, so that the polar table computed at compile time rounds to the same doubles as std::polar
+struct DoubleDouble
+{
+	double m_hi = 0.;
+	double m_lo = 0.;
+};
+
+constexpr DoubleDouble getQuickTwoSum(double a, double b)
+{
+	double sum = a + b;
+	return { sum, b - (sum - a) };
+}
+
+constexpr DoubleDouble getTwoSum(double a, double b)
+{
+	double sum = a + b;
+	double bb = sum - a;
+	return { sum, (a - (sum - bb)) + (b - bb) };
+}
+
+constexpr DoubleDouble getSplit(double a)
+{
+	double c = 134217729. * a;
+	double hi = c - (c - a);
+	return { hi, a - hi };
+}
+
+constexpr DoubleDouble getTwoProduct(double a, double b)
+{
+	double product = a * b;
+	auto splitA = getSplit(a), splitB = getSplit(b);
+	return { product, ((splitA.m_hi * splitB.m_hi - product) + splitA.m_hi * splitB.m_lo + splitA.m_lo * splitB.m_hi) + splitA.m_lo * splitB.m_lo };
+}
+
+constexpr DoubleDouble operator+(DoubleDouble a, DoubleDouble b)
+{
+	auto sum = getTwoSum(a.m_hi, b.m_hi);
+	return getQuickTwoSum(sum.m_hi, sum.m_lo + a.m_lo + b.m_lo);
+}
+
+constexpr DoubleDouble operator*(DoubleDouble a, DoubleDouble b)
+{
+	auto product = getTwoProduct(a.m_hi, b.m_hi);
+	return getQuickTwoSum(product.m_hi, product.m_lo + a.m_hi * b.m_lo + a.m_lo * b.m_hi);
+}
+
+constexpr DoubleDouble operator/(DoubleDouble a, double b)
 {
-	std::array<Z, 360> polarArray;
-	for (Angle angle = 0; angle < 360; ++angle)
-		polarArray[angle] = std::polar(1., radByDeg * angle);
-	return polarArray;
+	double quotient = a.m_hi / b;
+	auto product = getTwoProduct(quotient, b);
+	return getQuickTwoSum(quotient, ((a.m_hi - product.m_hi) - product.m_lo + a.m_lo) / b);
 }
 
+struct PolarTable
+{
+	// cos and sin of radByDeg * angle: reduced by quadrant against a double-double pi / 2, then Taylor series up to 1e-32
+	constexpr PolarTable() : m_cos(), m_sin()
+	{
+		constexpr DoubleDouble halfPi = { 1.5707963267948966, 6.123233995736766e-17 };
+		for (Angle angle = 0; angle < 360; ++angle)
+		{
+			double theta = radByDeg * angle;
+			int quadrant = static_cast<int>(theta / halfPi.m_hi + .5);
+			auto reduced = DoubleDouble{ theta } + DoubleDouble{ -static_cast<double>(quadrant) } * halfPi;
+			auto square = reduced * reduced;
+			DoubleDouble sin = reduced, cos = { 1. }, sinTerm = reduced, cosTerm = { 1. };
+			for (int n = 1; n <= 15; ++n)
+			{
+				sinTerm = sinTerm * square / static_cast<double>(-2 * n * (2 * n + 1));
+				cosTerm = cosTerm * square / static_cast<double>(-(2 * n - 1) * 2 * n);
+				sin = sin + sinTerm;
+				cos = cos + cosTerm;
+			}
+			double const quadrantCos[] = { cos.m_hi, -sin.m_hi, -cos.m_hi, sin.m_hi };
+			double const quadrantSin[] = { sin.m_hi, cos.m_hi, -sin.m_hi, -cos.m_hi };
+			m_cos[angle] = quadrantCos[quadrant % 4];
+			m_sin[angle] = quadrantSin[quadrant % 4];
+		}
+	}
+
+	alignas(64) std::array<double, 360> m_cos;
+	alignas(64) std::array<double, 360> m_sin;
+};
+
+static constexpr PolarTable polarTable;
+
 static Z getPolar(Angle angle)
 {
-	static auto const polarArray = getPolarArray();
-	return polarArray[get360Angle(angle)];
+	auto index = get360Angle(angle);
+	return { polarTable.m_cos[index], polarTable.m_sin[index] };
+}
+
+// Coefficients of a minimax polynomial in t * t of atan(t) / t on [0, 1], the error on atan is below 1e-7 degree
+const std::array<double, 10> atanCoefficients = { 0.99999999716054422, -0.33333276291968977, 0.1999807528082414, -0.14260016079705623, 0.10932341485896302
+	, -0.083497249245010605, 0.057089555186985309, -0.030351864043404932, 0.010487648853086284, -0.0017011699732393027 };
+const double fastAngleTolerance = 1e-6;
+
+// Degrees of std::arg(z) within 1e-7, the octant is selected without branches and the polynomial evaluated in Estrin form for a short dependency chain
+static double getFastArg(Z const& z)
+{
+	auto x = z.real(), y = z.imag();
+	auto absX = std::abs(x), absY = std::abs(y);
+	auto t = std::min(absX, absY) / std::max(absX, absY);
+	auto const& c = atanCoefficients;
+	auto s = t * t, s2 = s * s, s4 = s2 * s2, s8 = s4 * s4;
+	auto polynomial = ((c[0] + c[1] * s) + s2 * (c[2] + c[3] * s)) + s4 * ((c[4] + c[5] * s) + s2 * (c[6] + c[7] * s)) + s8 * (c[8] + c[9] * s);
+	auto angle = t * polynomial * degByRad;
+	angle = absY > absX ? 90. - angle : angle;
+	angle = x < 0. ? 180. - angle : angle;
+	return y < 0. ? -angle : angle;
+}
+
+// Degrees of std::acos(u) within 1e-7, for u in [0, 1]
+static double getFastAcos(double u)
+{
+	return getFastArg({ u, std::sqrt((1. - u) * (1. + u)) });
+}
+
+// std::round(degrees) when degrees, known within fastAngleTolerance, cannot be on the other side of a tie, false otherwise or for NaN
+static bool roundFastAngle(double degrees, Angle& rounded)
+{
+	// Angles stay within a few turns, so the shifted value is positive and its truncation is its floor
+	const double shift = 4096.;
+	auto shifted = degrees + shift;
+	if (!(shifted > 0. && shifted < 2. * shift))
+		return false;
+	auto floor = static_cast<Angle>(shifted);
+	auto fraction = shifted - floor;
+	if (!(std::abs(fraction - .5) >= fastAngleTolerance))
+		return false;
+	rounded = (fraction < .5 ? floor : floor + 1) - static_cast<Angle>(shift);
+	return true;
+}
+
+// std::round(std::arg(target) * degByRad - angle), exact std::arg being only needed near ties
+static Angle getRoundedAngleTo(Z const& target, Angle angle)
+{
+	Angle rounded;
+	if (roundFastAngle(getFastArg(target) - angle, rounded))
+		return rounded;
+	return static_cast<Angle>(std::round(std::arg(target) * degByRad - angle));
+}
+
+// std::round(std::arg(target) * degByRad + (90. - std::acos(u) * degByRad) * sign - angle), as aimed by getDirectCommand2, inline since the bot does not instantiate the latter
+static inline Angle getRoundedAimedAngle(Z const& target, double u, double sign, Angle angle)
+{
+	Angle rounded;
+	if (roundFastAngle(getFastArg(target) + (90. - (u < 1. ? getFastAcos(u) : 0.)) * sign - angle, rounded))
+		return rounded;
+	auto aimedAngle = std::arg(target) * degByRad;
+	aimedAngle += (90. - (u < 1. ? std::acos(u) * degByRad : 0.)) * sign;
+	return static_cast<Angle>(std::round(aimedAngle - angle));
+}
+
+static double truncate(double d)
+{
+	return std::trunc(d + std::copysign(epsilon, d));
 }
 
 static Z truncateZ(Z z)
 {
-	return { std::trunc(z.real() + copysign(epsilon, z.real())), std::trunc(z.imag() + copysign(epsilon, z.imag())) };
+	return { truncate(z.real()), truncate(z.imag()) };
+}
+
+static std::int32_t truncateInt(double d)
+{
+	return static_cast<std::int32_t>(d + std::copysign(epsilon, d));
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -248,8 +988,19 @@ struct Checkpoints
 {
 	std::vector<Z> m_checkpoints;
 	std::vector<Distance> m_distances;
+	std::vector<Distance> m_gapsSums;
 	std::vector<Step> m_targetSteps;
 	Count m_stepsByLap = 0u;
+	std::vector<std::uint8_t> m_costsToGo;
+	std::vector<Iteration> m_directIterations;
+	Count m_costToGoSteps = 0u;
+	std::chrono::steady_clock::duration m_costsToGoDuration = {};
+
+	// Cells of the cost-to-go table, in the frame of a checkpoint and of the direction to the next one
+	static constexpr Count costToGoDistances = 16, costToGoBearings = 8, costToGoHeadings = 8, costToGoSpeeds = 6;
+	static constexpr Count costToGoCells = costToGoDistances * costToGoBearings * costToGoHeadings * costToGoSpeeds;
+	static constexpr Distance costToGoDistanceMax = 18400., costToGoSpeedWidth = 200.;
+	static constexpr Iteration costToGoIterationsMax = std::numeric_limits<std::uint8_t>::max();
 
 	void fill(IO& io, Config const& config)
 	{
@@ -260,6 +1011,11 @@ struct Checkpoints
 		for (Index index = 1; index < m_checkpoints.size(); ++index)
 			m_distances[index] = std::abs(m_checkpoints[index] - m_checkpoints[index - 1]);
 
+		// m_gapsSums[step] sums the distances between the edges of consecutive checkpoints up to step
+		m_gapsSums.resize(m_checkpoints.size(), 0.);
+		for (Index index = 1; index < m_checkpoints.size(); ++index)
+			m_gapsSums[index] = m_gapsSums[index - 1] + std::max(m_distances[index] - 2. * checkpointRadius, 0.);
+
 		m_targetSteps.resize(m_checkpoints.size(), 0u);
 		for (Step step = 0; step < m_targetSteps.size(); ++step)
 		{
@@ -275,9 +1031,41 @@ struct Checkpoints
 			m_targetSteps[step] = std::min(std::max(targetStep, step + config.m_targetStep), m_checkpoints.size());
 		}
 		m_stepsByLap = m_checkpoints.size() / lapsCount;
+		if (config.m_rolloutHorizon)
+			fillCostsToGo(io, config);
 	}
 
-	static Checkpoints read(IO& io, Config const& config)
+	void fillCostsToGo(IO& io, Config const& config);
+
+	static Index getBin(double value, double max, Count bins)
+	{
+		return std::min(static_cast<Index>(std::max(value, 0.) / max * bins), static_cast<Index>(bins - 1));
+	}
+
+	static Index getAngleBin(double radians, Count bins)
+	{
+		return getBin(std::remainder(radians, 2. * pi) + pi, 2. * pi, bins);
+	}
+
+	static double getAngleBinCenter(Index bin, Count bins)
+	{
+		return (bin + .5) * 2. * pi / bins - pi;
+	}
+
+	// Distances are binned on a square root scale, finer near the checkpoint
+	Index getCostToGoCell(Step step, Z const& position, Z const& speed, Angle angle) const
+	{
+		auto const& checkpoint = m_checkpoints[step];
+		auto toCheckpoint = checkpoint - position;
+		auto frame = std::arg(m_checkpoints[(step + 1) % m_checkpoints.size()] - checkpoint);
+		auto distanceBin = getBin(std::sqrt(std::abs(toCheckpoint) / costToGoDistanceMax), 1., costToGoDistances);
+		auto bearingBin = getAngleBin(std::arg(-toCheckpoint) - frame, costToGoBearings);
+		auto headingBin = getAngleBin(angle * radByDeg - std::arg(toCheckpoint), costToGoHeadings);
+		auto speedBin = getBin(std::abs(speed), costToGoSpeedWidth * costToGoSpeeds, costToGoSpeeds);
+		return ((distanceBin * costToGoBearings + bearingBin) * costToGoHeadings + headingBin) * costToGoSpeeds + speedBin;
+	}
+
+	static Checkpoints read(IO& io, Config const& config)
 	{
 		Checkpoints checkpoints;
 		checkpoints.fill(io, config);
@@ -291,6 +1079,43 @@ struct Game
 	Checkpoints m_checkpoints;
 };
 
+// Choices of the hot path read from the configuration at every use
+struct ConfigPolicy
+{
+	static unsigned getDirectCommandVersion(Config const& config) { return config.m_directCommandVersion; }
+	static bool useDisksOfRotation(Config const& config) { return config.m_useDisksOfRotation; }
+	static bool pruneRollouts(Config const& config) { return config.m_pruneRollouts; }
+	static bool isAtLevel(Config const& config, RunLevel runLevel) { return config.m_runLevel <= runLevel; }
+	static bool instrument(Config const& config) { return config.m_instrument; }
+};
+
+// Same choices fixed at compile time, levels below minRunLevel and the instrumentation compile to nothing
+template<unsigned directCommandVersion, bool disksOfRotation, bool prune, RunLevel minRunLevel>
+struct StaticPolicy
+{
+	static constexpr unsigned getDirectCommandVersion(Config const&) { return directCommandVersion; }
+	static constexpr bool useDisksOfRotation(Config const&) { return disksOfRotation; }
+	static constexpr bool pruneRollouts(Config const&) { return prune; }
+	static constexpr bool isAtLevel(Config const& config, RunLevel runLevel) { return runLevel >= minRunLevel && config.m_runLevel <= runLevel; }
+	static constexpr bool instrument(Config const&) { return false; }
+};
+
+using ReleasePolicy = StaticPolicy<0, true, true, RunLevel::Release>;
+
+// Calls f with the static policy matching config when there is one, with ConfigPolicy otherwise
+template<typename F>
+static void dispatchPolicy(Config const& config, F&& f)
+{
+	if (config.m_runLevel == RunLevel::Release && config.m_useDisksOfRotation && config.m_pruneRollouts && !config.m_instrument)
+	{
+		if (config.m_directCommandVersion == 0)
+			return f(ReleasePolicy());
+		if (config.m_directCommandVersion == 1)
+			return f(StaticPolicy<1, true, true, RunLevel::Release>());
+	}
+	f(ConfigPolicy());
+}
+
 template<typename C, typename D>
 static std::ostream& join(std::ostream& os, C const& collection, D const& delimiter)
 {
@@ -322,6 +1147,24 @@ static double getCollisionTime(Z const& position, Z const& speed, Z const& check
 	return delta < 0. ? -1 : (-b - sqrt(delta)) / (2. * a);
 }
 
+static bool isOutDisksOfRotation(Z const& position, Z const& speed, Z const& point, Distance pointRadius)
+{
+	Z halfNext = position + .5 * speed;
+	Z diskRadius = 1.i * speed * halfInverseTanHalfAngleMax;
+	Z diskCenter1 = halfNext + diskRadius;
+	Z diskCenter2 = halfNext - diskRadius;
+	auto disksRadius = std::abs(speed) * halfInverseSinHalfAngleMax;
+	// Squared distances decide unless they are too close to the limit, then the distances compared as before do
+	auto limit = disksRadius + pointRadius;
+	auto limitSquare = limit * limit;
+	auto norm1 = std::norm(point - diskCenter1);
+	auto norm2 = std::norm(point - diskCenter2);
+	auto tolerance = 1e-9 * limitSquare;
+	if (std::abs(norm1 - limitSquare) > tolerance && std::abs(norm2 - limitSquare) > tolerance)
+		return norm1 > limitSquare && norm2 > limitSquare;
+	return std::abs(point - diskCenter1) - pointRadius > disksRadius && std::abs(point - diskCenter2) - pointRadius > disksRadius;
+}
+
 struct State
 {
 	State() = default;
@@ -346,20 +1189,63 @@ struct State
 		return ::getCollisionTime(m_position, m_speed, checkpoint);
 	}
 
+	Z const& getPosition() const
+	{
+		return m_position;
+	}
+
+	Z const& getSpeed() const
+	{
+		return m_speed;
+	}
+
+	bool isOutDisksOfRotation(Game const& game, IO& io, Z const& point, Distance pointRadius) const
+	{
+		return ::isOutDisksOfRotation(m_position, m_speed, point, pointRadius);
+	}
+};
+
+// Search-side state: Command::move truncates positions and speeds after every step, so they are stored as integers
+struct CompactState
+{
+	CompactState() = default;
+	explicit CompactState(State const& state)
+		: m_x(static_cast<std::int32_t>(state.m_position.real())), m_y(static_cast<std::int32_t>(state.m_position.imag()))
+		, m_vx(static_cast<std::int32_t>(state.m_speed.real())), m_vy(static_cast<std::int32_t>(state.m_speed.imag()))
+		, m_angle(static_cast<std::int16_t>(state.m_angle)), m_step(static_cast<std::uint16_t>(state.m_step)), m_iteration(static_cast<std::uint16_t>(state.m_iteration))
+	{}
+
+	std::int32_t m_x = {}, m_y = {}, m_vx = {}, m_vy = {};
+	std::int16_t m_angle = {};
+	std::uint16_t m_step = {};
+	std::uint16_t m_iteration = {};
+
+	Z getPosition() const
+	{
+		return { static_cast<Distance>(m_x), static_cast<Distance>(m_y) };
+	}
+
+	Z getSpeed() const
+	{
+		return { static_cast<Distance>(m_vx), static_cast<Distance>(m_vy) };
+	}
+
+	State getState(double collisionTime) const
+	{
+		State state(m_step, getPosition(), getSpeed(), m_angle);
+		state.m_iteration = m_iteration;
+		state.m_collisionTime = collisionTime;
+		return state;
+	}
+
 	bool isOutDisksOfRotation(Game const& game, IO& io, Z const& point, Distance pointRadius) const
 	{
-		Z halfNext = m_position + .5 * m_speed;
-		Z diskRadius = 1.i * m_speed * halfInverseTanHalfAngleMax;
-		Z diskCenter1 = halfNext + diskRadius;
-		Z diskCenter2 = halfNext - diskRadius;
-		auto distance1 = std::abs(point - diskCenter1);
-		auto distance2 = std::abs(point - diskCenter2);
-		auto disksRadius = std::abs(m_speed) * halfInverseSinHalfAngleMax;
-		//logAtLevel(game, RunLevel::Debug, io) << "isOutDisksOfRotation" << " distance1=" << distance1 << " distance2=" << distance2 << " disksRadius=" << disksRadius << " speed=" << std::abs(m_speed) << std::endl;
-		return distance1 - pointRadius > disksRadius && distance2 - pointRadius > disksRadius;
+		return ::isOutDisksOfRotation(getPosition(), getSpeed(), point, pointRadius);
 	}
 };
 
+static_assert(sizeof(CompactState) == 24, "CompactState should stay as small as possible");
+
 static bool operator==(State const& lhs, State const& rhs)
 {
 	return lhs.m_step == rhs.m_step && lhs.m_iteration == rhs.m_iteration && lhs.m_angle == rhs.m_angle
@@ -402,9 +1288,9 @@ struct Command
 	Angle m_angle = {};
 	Thrust m_thrust = {};
 
-	static Command getRandom()
+	static Command getRandom(Random& random)
 	{
-		return { getRandomAngle(), getRandomThrust() };
+		return { getRandomAngle(random), getRandomThrust(random) };
 	}
 
 	State move(Game const& game, State state) const
@@ -425,6 +1311,31 @@ struct Command
 		state.m_speed = truncateZ(state.m_speed);
 		return state;
 	}
+
+	// Same operations as above on the compact state, collisionTime receives what State::m_collisionTime would hold
+	CompactState move(Game const& game, CompactState state, double& collisionTime) const
+	{
+		Angle angle = get360Angle(state.m_angle + m_angle);
+		auto thrust = static_cast<Z::value_type>(m_thrust);
+		Z speed(state.m_vx + thrust * polarTable.m_cos[angle], state.m_vy + thrust * polarTable.m_sin[angle]);
+		Z position = state.getPosition();
+		collisionTime = ::getCollisionTime(position, speed, game.m_checkpoints.m_checkpoints[state.m_step]);
+		position += speed;
+		speed *= 1. - friction;
+		state.m_angle = static_cast<std::int16_t>(angle);
+		++state.m_iteration;
+
+		if (0 <= collisionTime && collisionTime <= 1.)
+			++state.m_step;
+		else
+			collisionTime = 0.;
+
+		state.m_x = truncateInt(position.real());
+		state.m_y = truncateInt(position.imag());
+		state.m_vx = truncateInt(speed.real());
+		state.m_vy = truncateInt(speed.imag());
+		return state;
+	}
 };
 
 static std::ostream& operator<<(std::ostream& os, Command const& c)
@@ -432,29 +1343,26 @@ static std::ostream& operator<<(std::ostream& os, Command const& c)
 	return os << "EXPERT " << c.m_angle << " " << c.m_thrust;
 }
 
-static Command getDirectCommand(Game const& game, IO& io, State const& state, double speedFactor)
+template<typename Policy = ConfigPolicy, typename S>
+static Command getDirectCommand(Game const& game, IO& io, S const& state, double speedFactor)
 {
-	if (game.m_config.m_directCommandVersion == 0)
+	if (Policy::getDirectCommandVersion(game.m_config) == 0)
 	{
-		//logAtLevel(game, RunLevel::Debug, io) << "getDirectCommand" << " state:" << state << std::endl;
 		auto const& checkpoint = game.m_checkpoints.m_checkpoints[state.m_step];
-		auto nextTarget = checkpoint - state.m_position - speedFactor * state.m_speed;
-		auto angleToTarget = std::arg(nextTarget) * degByRad;
-		auto commandAngle = get180Angle(static_cast<Angle>(std::round(angleToTarget - state.m_angle)));
+		auto nextTarget = checkpoint - state.getPosition() - speedFactor * state.getSpeed();
+		auto commandAngle = get180Angle(getRoundedAngleTo(nextTarget, state.m_angle));
 		if (isValidAngle(commandAngle))
 			return Command(commandAngle, thrustMax);
-		if (game.m_config.m_useDisksOfRotation && state.isOutDisksOfRotation(game, io, checkpoint, game.m_config.m_radiusFactor * checkpointRadius))
+		if (Policy::useDisksOfRotation(game.m_config) && state.isOutDisksOfRotation(game, io, checkpoint, game.m_config.m_radiusFactor * checkpointRadius))
 			return Command(getValidAngle(commandAngle), thrustMax);
 		return Command(getValidAngle(commandAngle), 0);
 	}
-	if (game.m_config.m_directCommandVersion == 1)
+	if (Policy::getDirectCommandVersion(game.m_config) == 1)
 	{
-		//logAtLevel(game, RunLevel::Debug, io) << "getDirectCommand" << " state:" << state << std::endl;
 		auto const& checkpoint = game.m_checkpoints.m_checkpoints[state.m_step];
-		auto nextTarget = checkpoint - state.m_position - speedFactor * state.m_speed;
-		auto angleToTarget = std::arg(nextTarget) * degByRad;
-		auto commandAngle = get180Angle(static_cast<Angle>(std::round(angleToTarget - state.m_angle)));
-		if (game.m_config.m_useDisksOfRotation && !state.isOutDisksOfRotation(game, io, checkpoint, game.m_config.m_radiusFactor * checkpointRadius))
+		auto nextTarget = checkpoint - state.getPosition() - speedFactor * state.getSpeed();
+		auto commandAngle = get180Angle(getRoundedAngleTo(nextTarget, state.m_angle));
+		if (Policy::useDisksOfRotation(game.m_config) && !state.isOutDisksOfRotation(game, io, checkpoint, game.m_config.m_radiusFactor * checkpointRadius))
 			return Command(std::copysign(angleMax, getValidAngle(commandAngle)), 0);
 		if (isValidAngle(commandAngle))
 			return Command(commandAngle, thrustMax);
@@ -463,29 +1371,28 @@ static Command getDirectCommand(Game const& game, IO& io, State const& state, do
 	return {};
 }
 
-static Command getDirectCommand2(Game const& game, IO& io, State const& state)
+template<typename S>
+static Command getDirectCommand2(Game const& game, IO& io, S const& state)
 {
 	auto const& checkpoint = game.m_checkpoints.m_checkpoints[state.m_step];
-	auto target = checkpoint - state.m_position;
-	auto aimedAngle = std::arg(target) * degByRad;
-	auto targetSpeed = target * std::conj(state.m_speed);
+	auto target = checkpoint - state.getPosition();
+	auto targetSpeed = target * std::conj(state.getSpeed());
 	if (targetSpeed.real() <= 0)
 	{
+		// state.m_angle - aimedAngle is the exact opposite of aimedAngle - state.m_angle, and std::round is symmetric
+		auto roundedAngle = getRoundedAngleTo(target, state.m_angle);
 		Thrust thrust = 0;
-		if (std::abs(get180Angle(static_cast<Angle>(std::round(state.m_angle - aimedAngle)))) < 90.)
+		if (std::abs(get180Angle(-roundedAngle)) < 90.)
 			if (!game.m_config.m_useDisksOfRotation || state.isOutDisksOfRotation(game, io, checkpoint, checkpointRadius))
 				thrust = thrustMax;
-		auto commandAngle = get180Angle(static_cast<Angle>(std::round(aimedAngle - state.m_angle)));
+		auto commandAngle = get180Angle(roundedAngle);
 		return Command(getValidAngle(commandAngle), thrust);
 	}
 	Thrust thrust = 0;
 	auto absTarget = std::abs(target);
 	auto heightTarget = std::abs(targetSpeed.imag()) / absTarget;
 	auto radius = static_cast<Distance>(thrustMax);
-	auto heightAngle = heightTarget < radius ? std::acos(heightTarget / radius) * degByRad : 0;
-	auto deltatAimedAngle = (90. - heightAngle) * copysign(1., targetSpeed.imag());
-	aimedAngle += deltatAimedAngle;
-	auto commandAngle = get180Angle(static_cast<Angle>(std::round(aimedAngle - state.m_angle)));
+	auto commandAngle = get180Angle(getRoundedAimedAngle(target, heightTarget / radius, copysign(1., targetSpeed.imag()), state.m_angle));
 	if (!game.m_config.m_useDisksOfRotation && isValidAngle(commandAngle))
 		return Command(getValidAngle(commandAngle), thrustMax);
 	if (game.m_config.m_useDisksOfRotation && state.isOutDisksOfRotation(game, io, checkpoint, checkpointRadius))
@@ -493,35 +1400,79 @@ static Command getDirectCommand2(Game const& game, IO& io, State const& state)
 	return Command(getValidAngle(commandAngle), 0);
 }
 
+// Turns taken by getDirectCommand to pass the next m_costToGoSteps checkpoints from the center of every cell, for each checkpoint of the first lap
+// m_directIterations holds the iterations of a direct run of the whole race from the last checkpoint, for the checkpoints beyond
+void Checkpoints::fillCostsToGo(IO& io, Config const& config)
+{
+	auto startTimePoint = now();
+	Game game;
+	game.m_config = config;
+	game.m_checkpoints = *this;
+	auto runDirect = [&game, &io, &config](CompactState state, Step targetStep, Iteration iterationMax, auto&& onStep)
+	{
+		double collisionTime = 0.;
+		while (state.m_step < targetStep && state.m_iteration < iterationMax)
+		{
+			auto step = state.m_step;
+			state = getDirectCommand(game, io, state, config.m_speedFactor).move(game, state, collisionTime);
+			if (state.m_step != step)
+				onStep(step, state.m_iteration);
+		}
+	};
+
+	m_costToGoSteps = std::max(std::min<Count>(config.m_costToGoSteps, m_checkpoints.size() - m_stepsByLap), 1u);
+	m_costsToGo.assign(m_stepsByLap * costToGoCells * m_costToGoSteps, static_cast<std::uint8_t>(costToGoIterationsMax));
+	for (Step lapStep = 0; lapStep < m_stepsByLap; ++lapStep)
+	{
+		auto const& checkpoint = m_checkpoints[lapStep];
+		auto frame = std::arg(m_checkpoints[lapStep + 1] - checkpoint);
+		for (Index distanceBin = 0; distanceBin < costToGoDistances; ++distanceBin)
+			for (Index bearingBin = 0; bearingBin < costToGoBearings; ++bearingBin)
+				for (Index headingBin = 0; headingBin < costToGoHeadings; ++headingBin)
+					for (Index speedBin = 0; speedBin < costToGoSpeeds; ++speedBin)
+					{
+						auto distance = (distanceBin + .5) * (distanceBin + .5) / (costToGoDistances * costToGoDistances) * costToGoDistanceMax;
+						Z position = checkpoint + std::polar(distance, frame + getAngleBinCenter(bearingBin, costToGoBearings));
+						auto angle = get360Angle(static_cast<Angle>(std::lround((std::arg(checkpoint - position) + getAngleBinCenter(headingBin, costToGoHeadings)) * degByRad)));
+						Z speed = (speedBin + .5) * costToGoSpeedWidth * getPolar(angle);
+						State state(lapStep, truncateZ(position), truncateZ(speed), angle);
+						auto cell = ((distanceBin * costToGoBearings + bearingBin) * costToGoHeadings + headingBin) * costToGoSpeeds + speedBin;
+						auto costs = &m_costsToGo[(lapStep * costToGoCells + cell) * m_costToGoSteps];
+						runDirect(CompactState(state), lapStep + m_costToGoSteps, costToGoIterationsMax, [costs, lapStep](Step step, Iteration iteration) { costs[step - lapStep] = static_cast<std::uint8_t>(iteration); });
+					}
+	}
+
+	m_directIterations.assign(m_checkpoints.size(), iterationLimit);
+	auto start = m_checkpoints.back();
+	State state(0, start, {}, static_cast<Angle>(std::lround(std::arg(m_checkpoints.front() - start) * degByRad)));
+	runDirect(CompactState(state), m_checkpoints.size(), iterationLimit, [this](Step step, Iteration iteration) { m_directIterations[step] = iteration; });
+	m_costsToGoDuration = now() - startTimePoint;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Packed in 32 bits, Direct sequences always use the configured speed factor
 struct TestSequence
 {
-	enum class Type { Direct = 0, Forced = 1, Count = 2 };
+	enum class Type : std::uint8_t { Direct = 0, Forced = 1, Count = 2 };
 
 	Type m_type = Type::Direct;
-	union
-	{
-		struct
-		{
-			double m_speedFactor;
-		};
-		struct
-		{
-			Angle m_angle;
-			Thrust m_thrust;
-		};
-	};
-	Count m_iterations = {};
+	std::int8_t m_angle = {};
+	std::uint8_t m_thrust = {};
+	std::uint8_t m_iterations = {};
 };
 
+static_assert(sizeof(TestSequence) == 4, "TestSequence should be packed in 32 bits");
+
+const Count testSequenceIterationsLimit = std::numeric_limits<std::uint8_t>::max();
+
 static std::ostream& operator<<(std::ostream& os, TestSequence const& testSequence)
 {
 	if (testSequence.m_type == TestSequence::Type::Direct)
 		os << "D";
 	else if (testSequence.m_type == TestSequence::Type::Forced)
-		os << "F" << testSequence.m_angle << "T" << testSequence.m_thrust;
-	return os << testSequence.m_iterations;
+		os << "F" << static_cast<Angle>(testSequence.m_angle) << "T" << static_cast<Thrust>(testSequence.m_thrust);
+	return os << static_cast<Count>(testSequence.m_iterations);
 }
 
 static bool operator==(TestSequence const& lhs, TestSequence const& rhs)
@@ -546,7 +1497,7 @@ static bool compareTestSequence(TestSequence const& lhs, TestSequence const& rhs
 	{
 		if (lhs.m_type == TestSequence::Type::Direct)
 		{
-			return lhs.m_speedFactor == rhs.m_speedFactor;
+			return true;
 		}
 		if (lhs.m_type == TestSequence::Type::Forced)
 		{
@@ -559,18 +1510,84 @@ static bool compareTestSequence(TestSequence const& lhs, TestSequence const& rhs
 const auto lastTestSequenceType = static_cast<int>(TestSequence::Type::Count) - 1;
 
 template<typename T, T min, T max>
-static T getRandomExcept(T except)
+static T getRandomExcept(Random& generator, T except)
 {
-	auto random = getRandom<T, min, max - 1>();
+	auto random = getRandom<T, min, max - 1>(generator);
 	return random >= except ? random + 1 : random;
 }
 
-static bool getRandomBool()
+static bool getRandomBool(Random& random)
 {
-	return !getRandom<unsigned, 0, 1>();
+	return !getRandom<unsigned, 0, 1>(random);
 }
 
-using TestSequences = std::deque<TestSequence>;
+const Count testSequencesCapacity = 32;
+
+// Inline storage so that copying candidates is a memcpy, insertions beyond the capacity are dropped by the callers
+struct TestSequences
+{
+	TestSequences() = default;
+	explicit TestSequences(Count size) : m_size(std::min(size, testSequencesCapacity))
+	{}
+
+	std::array<TestSequence, testSequencesCapacity> m_testSequences = {};
+	Count m_size = 0;
+
+	Count size() const { return m_size; }
+	bool empty() const { return !m_size; }
+	bool full() const { return m_size == testSequencesCapacity; }
+	TestSequence* begin() { return m_testSequences.data(); }
+	TestSequence* end() { return m_testSequences.data() + m_size; }
+	TestSequence const* begin() const { return m_testSequences.data(); }
+	TestSequence const* end() const { return m_testSequences.data() + m_size; }
+	TestSequence& operator[](Index index) { return m_testSequences[index]; }
+	TestSequence const& operator[](Index index) const { return m_testSequences[index]; }
+	TestSequence& back() { return m_testSequences[m_size - 1]; }
+
+	void push_back(TestSequence const& testSequence)
+	{
+		m_testSequences[m_size++] = testSequence;
+	}
+
+	void insert(TestSequence* position, TestSequence const& testSequence)
+	{
+		std::copy_backward(position, end(), end() + 1);
+		*position = testSequence;
+		++m_size;
+	}
+
+	void erase(TestSequence* position)
+	{
+		std::copy(position + 1, end(), position);
+		--m_size;
+	}
+};
+
+static_assert(std::is_trivially_copyable<TestSequences>::value, "TestSequences should be copied as a memcpy");
+
+// Read position in TestSequences, popping a command moves it forward and leaves the sequences untouched
+struct TestSequencesCursor
+{
+	TestSequences const* m_testSequences = nullptr;
+	Index m_index = 0;
+	Count m_iterations = 0;
+
+	void advance()
+	{
+		if (m_index < m_testSequences->size() && ++m_iterations == (*m_testSequences)[m_index].m_iterations)
+			transfer(m_index, m_index + 1, m_iterations, 0u);
+	}
+
+	// Elements not fully popped yet, the current one losing the iterations already popped
+	TestSequences getRemaining() const
+	{
+		TestSequences remaining(m_testSequences->size() - static_cast<Count>(m_index));
+		std::copy(m_testSequences->begin() + m_index, m_testSequences->end(), remaining.begin());
+		if (!remaining.empty())
+			remaining[0].m_iterations -= static_cast<std::uint8_t>(m_iterations);
+		return remaining;
+	}
+};
 
 static std::ostream& operator<<(std::ostream& os, TestSequences const& testSequences)
 {
@@ -579,87 +1596,111 @@ static std::ostream& operator<<(std::ostream& os, TestSequences const& testSeque
 	return os;
 }
 
-static TestSequence getRandomTestSequence(Game const& game, bool last)
+static TestSequence getRandomTestSequence(Game const& game, Random& random, bool last)
 {
 	TestSequence testSequence;
-	auto type = getRandom<int, 0, lastTestSequenceType + 1>();
+	auto type = getRandom<int, 0, lastTestSequenceType + 1>(random);
 	testSequence.m_type = static_cast<TestSequence::Type>(std::min(type, lastTestSequenceType));
-	if (testSequence.m_type == TestSequence::Type::Direct)
+	if (testSequence.m_type == TestSequence::Type::Forced)
 	{
-		testSequence.m_speedFactor = game.m_config.m_speedFactor;
+		testSequence.m_angle = getRandomBool(random) ? +angleMax : -angleMax;
+		testSequence.m_thrust = getRandomBool(random) ? thrustMax : 0;
 	}
-	else if (testSequence.m_type == TestSequence::Type::Forced)
-	{
-		testSequence.m_angle = getRandomBool() ? +angleMax : -angleMax;
-		testSequence.m_thrust = getRandomBool() ? thrustMax : 0;
-	}
-	testSequence.m_iterations = getRandom<Count>(1, game.m_config.m_testSequenceIterationsMax);
+	testSequence.m_iterations = static_cast<std::uint8_t>(getRandom<Count>(random, 1, std::min(game.m_config.m_testSequenceIterationsMax, testSequenceIterationsLimit)));
 	return testSequence;
 }
 
-static TestSequence getRandomTestSequence(Game const& game, bool last, TestSequence* previous, TestSequence* next)
+static TestSequence getRandomTestSequence(Game const& game, Random& random, bool last, TestSequence* previous, TestSequence* next)
 {
-	auto random = getRandomTestSequence(game, last);
-	if (previous && compareTestSequence(*previous, random))
-		return getRandomTestSequence(game, last, previous, next);
-	if (next && compareTestSequence(*next, random))
-		return getRandomTestSequence(game, last, previous, next);
-	return random;
+	auto testSequence = getRandomTestSequence(game, random, last);
+	if (previous && compareTestSequence(*previous, testSequence))
+		return getRandomTestSequence(game, random, last, previous, next);
+	if (next && compareTestSequence(*next, testSequence))
+		return getRandomTestSequence(game, random, last, previous, next);
+	return testSequence;
 }
 
-static TestSequences getRandomTestSequences(Game const& game)
+static TestSequences getRandomTestSequences(Game const& game, Random& random)
 {
-	Count size = getRandom<Count>(1, game.m_config.m_testSequencesSizeMax);
+	Count size = getRandom<Count>(random, 1, std::min(game.m_config.m_testSequencesSizeMax, testSequencesCapacity));
 	TestSequences testSequences(size);
 	for (unsigned test = 0; test < size; ++test)
 	{
-		testSequences[test] = getRandomTestSequence(game, test + 1 == size, test ? &testSequences[test-1] : nullptr, nullptr);
+		testSequences[test] = getRandomTestSequence(game, random, test + 1 == size, test ? &testSequences[test-1] : nullptr, nullptr);
 	}
 	return testSequences;
 }
 
-static TestSequences mutateTestSequences(Game const& game, TestSequences testSequences)
+// firstChange receives the index of the first element differing from the given testSequences, or their size if none does
+static TestSequences mutateTestSequences(Game const& game, Random& random, TestSequences testSequences, Index& firstChange)
 {
-	if (getRandomBool())
+	firstChange = testSequences.size();
+	if (getRandomBool(random))
 		for (int index = 0; index < static_cast<int>(testSequences.size()); ++index)
 		{
-			testSequences[index].m_iterations += getRandom<int, -1, +1>();
+			auto delta = getRandom<int, -1, +1>(random);
+			if (delta > 0 && testSequences[index].m_iterations == testSequenceIterationsLimit)
+				delta = 0;
+			if (delta)
+				firstChange = std::min(firstChange, static_cast<Index>(index));
+			testSequences[index].m_iterations = static_cast<std::uint8_t>(testSequences[index].m_iterations + delta);
 			if (!testSequences[index].m_iterations)
 			{
 				testSequences.erase(testSequences.begin() + index);
 				--index;
 			}
 		}
-	if (getRandomBool())
+	if (getRandomBool(random))
 		for (unsigned index = 0; index < testSequences.size(); ++index)
 		{
-			if (!getRandom<std::size_t>(0, testSequences.size()))
+			if (!getRandom<std::size_t>(random, 0, testSequences.size()) && !testSequences.full())
 			{
-				testSequences.insert(testSequences.begin() + index, getRandomTestSequence(game, index == testSequences.size() - 1, index ? &testSequences[index-1] : nullptr, &testSequences[index]));
+				firstChange = std::min(firstChange, static_cast<Index>(index));
+				testSequences.insert(testSequences.begin() + index, getRandomTestSequence(game, random, index == testSequences.size() - 1, index ? &testSequences[index-1] : nullptr, &testSequences[index]));
 			}
 		}
-	if (getRandomBool())
-		testSequences.push_back(getRandomTestSequence(game, true, testSequences.empty() ? nullptr : &testSequences.back(), nullptr));
+	if (getRandomBool(random) && !testSequences.full())
+	{
+		firstChange = std::min(firstChange, static_cast<Index>(testSequences.size()));
+		testSequences.push_back(getRandomTestSequence(game, random, true, testSequences.empty() ? nullptr : &testSequences.back(), nullptr));
+	}
 	return testSequences;
 }
 
-static Command popCommand(TestSequences& testSequences, Game const& game, IO& io, State state)
+// One point crossover: a prefix of mother followed by a suffix of father, as much of it as the capacity allows
+static TestSequences crossTestSequences(Random& random, TestSequences const& mother, TestSequences const& father)
 {
-	if (testSequences.empty())
-		return getDirectCommand(game, io, state, game.m_config.m_speedFactor);
+	auto motherSize = getRandom<Count>(random, 0, mother.size());
+	auto fatherIndex = getRandom<Count>(random, 0, father.size());
+	TestSequences child(motherSize);
+	std::copy_n(mother.begin(), motherSize, child.begin());
+	for (auto testSequence = father.begin() + fatherIndex; testSequence != father.end() && !child.full(); ++testSequence)
+		child.push_back(*testSequence);
+	return child;
+}
+
+template<typename Policy = ConfigPolicy, typename S>
+static Command popCommand(TestSequencesCursor& cursor, Game const& game, IO& io, S const& state)
+{
+	if (cursor.m_index >= cursor.m_testSequences->size())
+	{
+		doIfInstrumented(Policy, game) ++counters.m_directCommandsCount;
+		return getDirectCommand<Policy>(game, io, state, game.m_config.m_speedFactor);
+	}
 	Command command;
-	auto& testSequence = testSequences.front();
+	auto const& testSequence = (*cursor.m_testSequences)[cursor.m_index];
 	if (testSequence.m_type == TestSequence::Type::Direct)
 	{
-		command = getDirectCommand(game, io, state, testSequence.m_speedFactor);
+		doIfInstrumented(Policy, game) ++counters.m_directCommandsCount;
+		command = getDirectCommand<Policy>(game, io, state, game.m_config.m_speedFactor);
 	}
 	else if (testSequence.m_type == TestSequence::Type::Forced)
 	{
+		doIfInstrumented(Policy, game) ++counters.m_forcedCommandsCount;
 		command.m_angle = testSequence.m_angle;
 		command.m_thrust = testSequence.m_thrust;
 	}
-	if (!--testSequence.m_iterations)
-		testSequences.pop_front();
+	cursor.advance();
 	return command;
 }
 
@@ -691,20 +1732,979 @@ static std::ostream& operator<<(std::ostream& os, StepIteration const& iteration
 	return os << "step=" << iteration.m_step << " iteration=" << iteration.m_iteration << " collisionTime=" << 100 * iteration.m_collisionTime << "%";
 }
 
-static StepIteration reachNext(IO& io, Game const& game, StepIteration const& stepIterationMax, Step targetStep, State state, TestSequences testSequences)
+// Upper bound of the distance covered in n turns from speed s: m_base[n] + s * m_speedFactor[n]
+// Speeds follow s' <= (1 - friction) * (s + thrustMax) + speedSlack, truncations adding speedSlack to speeds and positionSlack to positions
+struct ReachTable
+{
+	static constexpr double speedSlack = 1e-4;
+	static constexpr double positionSlack = 1.5;
+
+	constexpr ReachTable() : m_base(), m_speedFactor()
+	{
+		double terminalSpeed = ((1. - friction) * thrustMax + speedSlack) / friction;
+		double decay = 1.;
+		for (Iteration turns = 0; turns <= iterationLimit; ++turns)
+		{
+			m_speedFactor[turns] = (1. - decay) / friction;
+			m_base[turns] = turns * (terminalSpeed + thrustMax + positionSlack) - terminalSpeed * m_speedFactor[turns] + 1.;
+			decay *= 1. - friction;
+		}
+	}
+
+	std::array<double, iterationLimit + 1> m_base;
+	std::array<double, iterationLimit + 1> m_speedFactor;
+};
+
+static constexpr ReachTable reachTable;
+
+// False only when no commands can reach targetStep by iterationMax: every checkpoint takes a turn, and the distance to the edge
+// of the next one plus the gaps between the edges of the following ones cannot exceed what the speed recurrence allows
+static bool canReach(Game const& game, CompactState const& state, Step targetStep, Iteration iterationMax)
+{
+	auto turns = iterationMax - state.m_iteration;
+	if (turns < targetStep - state.m_step)
+		return false;
+	auto const& checkpoints = game.m_checkpoints;
+	auto vx = static_cast<double>(state.m_vx), vy = static_cast<double>(state.m_vy);
+	auto reachable = reachTable.m_base[turns] + std::sqrt(vx * vx + vy * vy) * reachTable.m_speedFactor[turns];
+	auto limit = reachable - (checkpoints.m_gapsSums[targetStep - 1] - checkpoints.m_gapsSums[state.m_step]) + checkpointRadius;
+	if (limit < 0.)
+		return false;
+	auto const& checkpoint = checkpoints.m_checkpoints[state.m_step];
+	auto dx = checkpoint.real() - state.m_x, dy = checkpoint.imag() - state.m_y;
+	return dx * dx + dy * dy <= limit * limit;
+}
+
+const Count deadlineMoves = 64;
+
+// End of a search: the clock is read on the first check and then every m_deadlineCheckInterval checks, once expired it stays so
+// Searches check it once per rollout and rollouts once every deadlineMoves moves
+struct Deadline
+{
+	Deadline(Game const& game, TimePoint limitTimePoint)
+		: m_limitTimePoint(limitTimePoint), m_checkInterval(std::max(game.m_config.m_deadlineCheckInterval, 1u))
+	{}
+
+	TimePoint m_limitTimePoint;
+	Count m_checkInterval;
+	Count m_countdown = 1u;
+	bool m_expired = false;
+
+	bool isExpired()
+	{
+		if (m_expired || --m_countdown)
+			return m_expired;
+		m_countdown = m_checkInterval;
+		m_expired = now() >= m_limitTimePoint;
+		return m_expired;
+	}
+};
+
+static Iteration getHorizonIteration(Game const& game, Iteration iteration)
+{
+	return game.m_config.m_rolloutHorizon ? iteration + game.m_config.m_rolloutHorizon : iterationLimit;
+}
+
+// Score of a rollout cut at the horizon: the table covers the next m_costToGoSteps checkpoints, the direct run of fillCostsToGo the following ones
+// The collision time is set to 1 so that a rollout which really reaches targetStep wins ties
+static StepIteration getCostToGo(Game const& game, CompactState const& state, Step targetStep, Iteration iterationMax)
+{
+	auto const& checkpoints = game.m_checkpoints;
+	auto steps = std::min<Step>(checkpoints.m_costToGoSteps, targetStep - state.m_step) - 1;
+	auto cell = checkpoints.getCostToGoCell(state.m_step, state.getPosition(), state.getSpeed(), state.m_angle);
+	auto lapStep = state.m_step % checkpoints.m_stepsByLap;
+	Iteration iteration = state.m_iteration + checkpoints.m_costsToGo[(lapStep * Checkpoints::costToGoCells + cell) * checkpoints.m_costToGoSteps + steps];
+	if (state.m_step + steps + 1 < targetStep)
+		iteration += checkpoints.m_directIterations[targetStep - 1] - checkpoints.m_directIterations[state.m_step + steps];
+	if (iteration >= iterationMax)
+		return { 0, iterationLimit, 0. };
+	return { targetStep, iteration, 1. };
+}
+
+// Counts the moves of a rollout ending with iteration, and the abort when there is one
+template<typename Policy>
+static StepIteration countRollout(Game const& game, Count movesCount, StepIteration const& iteration, std::uint64_t Counters::* abortsCount = nullptr)
+{
+	doIfInstrumented(Policy, game)
+	{
+		counters.m_movesCount += movesCount;
+		if (abortsCount)
+			++(counters.*abortsCount);
+	}
+	return iteration;
+}
+
+// A rollout stopped by canReach could not have ended by iterationMax, so it gets the same failure as one running out of iterations
+// Rollouts reaching horizonIteration are scored by getCostToGo, those interrupted by the deadline fail
+template<typename Policy = ConfigPolicy>
+static StepIteration reachNext(IO& io, Game const& game, StepIteration const& stepIterationMax, Step targetStep, Iteration horizonIteration, CompactState state, double collisionTime, TestSequencesCursor cursor, Deadline* deadline)
 {
 	Iteration iterationMax = targetStep == stepIterationMax.m_step ? stepIterationMax.m_iteration : iterationLimit;
-	while (true)
+	for (Count moves = 1; true; ++moves)
 	{
 		if (state.m_step >= targetStep)
-			return { state.m_step, state.m_iteration, state.m_collisionTime };
+			return countRollout<Policy>(game, moves - 1, { state.m_step, state.m_iteration, collisionTime });
 		if (state.m_iteration >= iterationMax)
-			return { 0, iterationLimit, 0. };
-		auto command = popCommand(testSequences, game, io, state);
-		state = command.move(game, std::move(state));
+			return countRollout<Policy>(game, moves - 1, { 0, iterationLimit, 0. }, &Counters::m_boundAbortsCount);
+		if (Policy::pruneRollouts(game.m_config) && !canReach(game, state, targetStep, iterationMax))
+			return countRollout<Policy>(game, moves - 1, { 0, iterationLimit, 0. }, &Counters::m_prunedRolloutsCount);
+		if (state.m_iteration >= horizonIteration)
+			return countRollout<Policy>(game, moves - 1, getCostToGo(game, state, targetStep, iterationMax));
+		if (deadline && !(moves % deadlineMoves) && deadline->isExpired())
+			return countRollout<Policy>(game, moves - 1, { 0, iterationLimit, 0. });
+		auto command = popCommand<Policy>(cursor, game, io, state);
+		state = command.move(game, state, collisionTime);
+	}
+}
+
+template<typename Policy = ConfigPolicy>
+static StepIteration reachNext(IO& io, Game const& game, StepIteration const& stepIterationMax, Step targetStep, State const& initialState, TestSequences const& testSequences, Deadline* deadline = nullptr)
+{
+	return reachNext<Policy>(io, game, stepIterationMax, targetStep, getHorizonIteration(game, initialState.m_iteration), CompactState(initialState), initialState.m_collisionTime, TestSequencesCursor{ &testSequences }, deadline);
+}
+
+// States reached by the rollout of testSequences at the start of each of their elements, until targetStep or the rollout horizon is reached
+// A cached state past the horizon would be scored by getCostToGo instead of the state at the horizon
+struct PrefixStates
+{
+	PrefixStates(IO& io, Game const& game, Step targetStep, State const& initialState, TestSequences const& testSequences)
+	{
+		CompactState state(initialState);
+		auto collisionTime = initialState.m_collisionTime;
+		auto iterationMax = std::min(getHorizonIteration(game, initialState.m_iteration), iterationLimit);
+		m_states.push_back(state);
+		m_collisionTimes.push_back(collisionTime);
+		TestSequencesCursor cursor{ &testSequences };
+		for (Index index = 0; index < testSequences.size(); ++index)
+		{
+			while (cursor.m_index == index && state.m_step < targetStep && state.m_iteration < iterationMax)
+			{
+				auto command = popCommand(cursor, game, io, state);
+				state = command.move(game, state, collisionTime);
+				doIfInstrumented(ConfigPolicy, game) ++counters.m_movesCount;
+			}
+			if (state.m_step >= targetStep || state.m_iteration >= iterationMax)
+				return;
+			m_states.push_back(state);
+			m_collisionTimes.push_back(collisionTime);
+		}
+	}
+
+	std::vector<CompactState> m_states;
+	std::vector<double> m_collisionTimes;
+
+	// Elements before firstChange are shared with the cached rollout, so resuming at the last cached start not after it gives the same result
+	Index getResumeIndex(Index firstChange) const
+	{
+		return std::min(firstChange, m_states.size() - 1);
+	}
+
+	template<typename Policy = ConfigPolicy>
+	StepIteration reachNext(IO& io, Game const& game, StepIteration const& stepIterationMax, Step targetStep, TestSequences const& testSequences, Index firstChange, Deadline* deadline = nullptr) const
+	{
+		auto index = getResumeIndex(firstChange);
+		return ::reachNext<Policy>(io, game, stepIterationMax, targetStep, getHorizonIteration(game, m_states[0].m_iteration), m_states[index], m_collisionTimes[index], TestSequencesCursor{ &testSequences, index }, deadline);
+	}
+};
+
+// Structure of arrays holding up to rolloutsBatchMax rollouts stepped together, so that Command::move is vectorized across lanes
+struct RolloutsBatch
+{
+	using Doubles = std::array<double, rolloutsBatchMax>;
+
+	// Lanes from size on copy the first one, they are inactive
+	RolloutsBatch(CompactState const* states, double const* collisionTimes, Count size)
+	{
+		m_collision.fill(0.);
+		m_thrust.fill(0.);
+		m_checkpointX.fill(0.);
+		m_checkpointY.fill(0.);
+		m_commandAngle.fill(0);
+		for (Index lane = 0; lane < rolloutsBatchMax; ++lane)
+		{
+			auto source = lane < size ? lane : 0;
+			auto const& state = states[source];
+			m_x[lane] = static_cast<double>(state.m_x);
+			m_y[lane] = static_cast<double>(state.m_y);
+			m_vx[lane] = static_cast<double>(state.m_vx);
+			m_vy[lane] = static_cast<double>(state.m_vy);
+			m_collisionTime[lane] = collisionTimes[source];
+			m_angle[lane] = state.m_angle;
+			m_step[lane] = state.m_step;
+			m_iteration[lane] = state.m_iteration;
+			m_active[lane] = lane < size;
+		}
+		m_lanesCount = (size + 3) & ~3u;
+	}
+
+	alignas(64) Doubles m_x, m_y, m_vx, m_vy, m_collisionTime, m_collision, m_thrust, m_checkpointX, m_checkpointY;
+	alignas(64) std::array<Angle, rolloutsBatchMax> m_angle, m_commandAngle;
+	std::array<Step, rolloutsBatchMax> m_step;
+	std::array<Iteration, rolloutsBatchMax> m_iteration;
+	std::array<bool, rolloutsBatchMax> m_active;
+	Count m_lanesCount;
+
+	CompactState getState(Index lane) const
+	{
+		CompactState state;
+		state.m_x = static_cast<std::int32_t>(m_x[lane]);
+		state.m_y = static_cast<std::int32_t>(m_y[lane]);
+		state.m_vx = static_cast<std::int32_t>(m_vx[lane]);
+		state.m_vy = static_cast<std::int32_t>(m_vy[lane]);
+		state.m_angle = static_cast<std::int16_t>(m_angle[lane]);
+		state.m_step = static_cast<std::uint16_t>(m_step[lane]);
+		state.m_iteration = static_cast<std::uint16_t>(m_iteration[lane]);
+		return state;
+	}
+
+	void setCommand(Game const& game, Index lane, Command const& command)
+	{
+		auto const& checkpoint = game.m_checkpoints.m_checkpoints[m_step[lane]];
+		m_checkpointX[lane] = checkpoint.real();
+		m_checkpointY[lane] = checkpoint.imag();
+		m_commandAngle[lane] = command.m_angle;
+		m_thrust[lane] = static_cast<double>(command.m_thrust);
+	}
+
+	// Inactive lanes keep a null command, they are still moved but never read again
+	void deactivate(Index lane)
+	{
+		m_active[lane] = false;
+		m_commandAngle[lane] = 0;
+		m_thrust[lane] = 0.;
+	}
+
+	void move()
+	{
+#ifdef AVX2_TARGET
+		static const bool avx2 = hasAvx2();
+		if (avx2)
+			moveAvx2();
+		else
+#endif
+			moveLanes();
+		for (Index lane = 0; lane < m_lanesCount; ++lane)
+			if (m_active[lane])
+			{
+				m_step[lane] += m_collision[lane] != 0.;
+				++m_iteration[lane];
+			}
+	}
+
+	// Same operations in the same order as Command::move, so that every lane stays bit-identical to the scalar path
+	void moveLanes()
+	{
+		for (Index lane = 0; lane < m_lanesCount; ++lane)
+		{
+			auto angle = m_angle[lane] + m_commandAngle[lane];
+			angle = angle < 0 ? angle + 360 : angle >= 360 ? angle - 360 : angle;
+			auto vx = m_vx[lane] + m_thrust[lane] * polarTable.m_cos[angle];
+			auto vy = m_vy[lane] + m_thrust[lane] * polarTable.m_sin[angle];
+
+			auto x = m_x[lane] - m_checkpointX[lane];
+			auto y = m_y[lane] - m_checkpointY[lane];
+			auto a = vx * vx + vy * vy;
+			auto b = 2. * (x * vx + y * vy);
+			auto c = x * x + y * y - checkpointRadiusSquare;
+			auto delta = b * b - 4. * a * c;
+			auto collisionTime = delta < 0. ? -1. : (-b - std::sqrt(delta)) / (2. * a);
+			auto collision = 0. <= collisionTime && collisionTime <= 1.;
+
+			m_angle[lane] = angle;
+			m_x[lane] = truncate(m_x[lane] + vx);
+			m_y[lane] = truncate(m_y[lane] + vy);
+			m_vx[lane] = truncate(vx * (1. - friction));
+			m_vy[lane] = truncate(vy * (1. - friction));
+			m_collisionTime[lane] = collision ? collisionTime : 0.;
+			m_collision[lane] = collision ? 1. : 0.;
+		}
+	}
+
+#ifdef AVX2_TARGET
+	AVX2_TARGET static __m256d truncateAvx2(__m256d d)
+	{
+		auto signedEpsilon = _mm256_or_pd(_mm256_and_pd(d, _mm256_set1_pd(-0.)), _mm256_set1_pd(epsilon));
+		return _mm256_round_pd(_mm256_add_pd(d, signedEpsilon), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+	}
+
+	// Four lanes per register, without FMA so that every rounding matches moveLanes
+	AVX2_TARGET void moveAvx2()
+	{
+		auto const zero = _mm256_setzero_pd();
+		auto const one = _mm256_set1_pd(1.);
+		auto const two = _mm256_set1_pd(2.);
+		auto const four = _mm256_set1_pd(4.);
+		auto const signMask = _mm256_set1_pd(-0.);
+		auto const radiusSquare = _mm256_set1_pd(checkpointRadiusSquare);
+		auto const frictionFactor = _mm256_set1_pd(1. - friction);
+		auto const angles = _mm_set1_epi32(360);
+		// Gathers are masked on every lane with a zero source, the plain gathers leave their source undefined and warn as maybe uninitialized
+		auto const allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+		for (Index lane = 0; lane < m_lanesCount; lane += 4)
+		{
+			auto angle = _mm_add_epi32(_mm_load_si128(reinterpret_cast<__m128i const*>(&m_angle[lane])), _mm_load_si128(reinterpret_cast<__m128i const*>(&m_commandAngle[lane])));
+			angle = _mm_add_epi32(angle, _mm_and_si128(_mm_cmplt_epi32(angle, _mm_setzero_si128()), angles));
+			angle = _mm_sub_epi32(angle, _mm_andnot_si128(_mm_cmplt_epi32(angle, angles), angles));
+			auto thrust = _mm256_load_pd(&m_thrust[lane]);
+			auto vx = _mm256_add_pd(_mm256_load_pd(&m_vx[lane]), _mm256_mul_pd(thrust, _mm256_mask_i32gather_pd(zero, polarTable.m_cos.data(), angle, allLanes, 8)));
+			auto vy = _mm256_add_pd(_mm256_load_pd(&m_vy[lane]), _mm256_mul_pd(thrust, _mm256_mask_i32gather_pd(zero, polarTable.m_sin.data(), angle, allLanes, 8)));
+
+			auto px = _mm256_load_pd(&m_x[lane]);
+			auto py = _mm256_load_pd(&m_y[lane]);
+			auto x = _mm256_sub_pd(px, _mm256_load_pd(&m_checkpointX[lane]));
+			auto y = _mm256_sub_pd(py, _mm256_load_pd(&m_checkpointY[lane]));
+			auto a = _mm256_add_pd(_mm256_mul_pd(vx, vx), _mm256_mul_pd(vy, vy));
+			auto b = _mm256_mul_pd(two, _mm256_add_pd(_mm256_mul_pd(x, vx), _mm256_mul_pd(y, vy)));
+			auto c = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y)), radiusSquare);
+			auto delta = _mm256_sub_pd(_mm256_mul_pd(b, b), _mm256_mul_pd(_mm256_mul_pd(four, a), c));
+			auto root = _mm256_div_pd(_mm256_sub_pd(_mm256_xor_pd(b, signMask), _mm256_sqrt_pd(delta)), _mm256_mul_pd(two, a));
+			auto collisionTime = _mm256_blendv_pd(root, _mm256_set1_pd(-1.), _mm256_cmp_pd(delta, zero, _CMP_LT_OQ));
+			auto collision = _mm256_and_pd(_mm256_cmp_pd(zero, collisionTime, _CMP_LE_OQ), _mm256_cmp_pd(collisionTime, one, _CMP_LE_OQ));
+
+			_mm_store_si128(reinterpret_cast<__m128i*>(&m_angle[lane]), angle);
+			_mm256_store_pd(&m_x[lane], truncateAvx2(_mm256_add_pd(px, vx)));
+			_mm256_store_pd(&m_y[lane], truncateAvx2(_mm256_add_pd(py, vy)));
+			_mm256_store_pd(&m_vx[lane], truncateAvx2(_mm256_mul_pd(vx, frictionFactor)));
+			_mm256_store_pd(&m_vy[lane], truncateAvx2(_mm256_mul_pd(vy, frictionFactor)));
+			_mm256_store_pd(&m_collisionTime[lane], _mm256_and_pd(collision, collisionTime));
+			_mm256_store_pd(&m_collision[lane], _mm256_and_pd(collision, one));
+		}
+	}
+#endif
+};
+
+// Batched equivalent of reachNext: iterations[lane] receives exactly what reachNext would return for testSequences[lane]
+// Lane i starts from states[i] with collisionTimes[i]
+template<typename Policy = ConfigPolicy>
+static void reachNextBatch(IO& io, Game const& game, StepIteration const& stepIterationMax, Step targetStep, Iteration horizonIteration, CompactState const* states, double const* collisionTimes, TestSequencesCursor* cursors, Count size, StepIteration* iterations, Deadline* deadline)
+{
+	assertAtPolicyLevel(Policy, game, RunLevel::Debug, size <= rolloutsBatchMax);
+	Iteration iterationMax = targetStep == stepIterationMax.m_step ? stepIterationMax.m_iteration : iterationLimit;
+	RolloutsBatch batch(states, collisionTimes, size);
+	for (Count moves = 1; true; ++moves)
+	{
+		bool expired = deadline && !(moves % deadlineMoves) && deadline->isExpired();
+		Count activeCount = 0;
+		for (Index lane = 0; lane < size; ++lane)
+		{
+			if (!batch.m_active[lane])
+				continue;
+			if (batch.m_step[lane] >= targetStep)
+			{
+				iterations[lane] = { batch.m_step[lane], batch.m_iteration[lane], batch.m_collisionTime[lane] };
+				batch.deactivate(lane);
+				continue;
+			}
+			auto state = batch.getState(lane);
+			if (batch.m_iteration[lane] >= iterationMax)
+			{
+				iterations[lane] = countRollout<Policy>(game, 0, { 0, iterationLimit, 0. }, &Counters::m_boundAbortsCount);
+				batch.deactivate(lane);
+				continue;
+			}
+			if (Policy::pruneRollouts(game.m_config) && !canReach(game, state, targetStep, iterationMax))
+			{
+				iterations[lane] = countRollout<Policy>(game, 0, { 0, iterationLimit, 0. }, &Counters::m_prunedRolloutsCount);
+				batch.deactivate(lane);
+				continue;
+			}
+			if (batch.m_iteration[lane] >= horizonIteration)
+			{
+				iterations[lane] = getCostToGo(game, state, targetStep, iterationMax);
+				batch.deactivate(lane);
+				continue;
+			}
+			if (expired)
+			{
+				iterations[lane] = { 0, iterationLimit, 0. };
+				batch.deactivate(lane);
+				continue;
+			}
+			auto command = popCommand<Policy>(cursors[lane], game, io, state);
+			assertAtPolicyLevel(Policy, game, RunLevel::Debug, isValidAngle(command.m_angle));
+			batch.setCommand(game, lane, command);
+			++activeCount;
+		}
+		if (!activeCount)
+			return;
+		countRollout<Policy>(game, activeCount, {});
+		batch.move();
+	}
+}
+
+template<typename Policy = ConfigPolicy>
+static void reachNextBatch(IO& io, Game const& game, StepIteration const& stepIterationMax, Step targetStep, State const& state, TestSequences const* testSequences, Count size, StepIteration* iterations, Deadline* deadline = nullptr)
+{
+	std::array<CompactState, rolloutsBatchMax> states;
+	std::array<double, rolloutsBatchMax> collisionTimes;
+	std::array<TestSequencesCursor, rolloutsBatchMax> cursors;
+	states.fill(CompactState(state));
+	collisionTimes.fill(state.m_collisionTime);
+	for (Index lane = 0; lane < size; ++lane)
+		cursors[lane] = { &testSequences[lane] };
+	reachNextBatch<Policy>(io, game, stepIterationMax, targetStep, getHorizonIteration(game, state.m_iteration), states.data(), collisionTimes.data(), cursors.data(), size, iterations, deadline);
+}
+
+// Best candidate found by one search thread; the shared bound lets threads prune against each other without locking
+struct SearchSlot
+{
+	StepIteration m_best;
+	TestSequences m_bestTestSequences;
+	Count m_testsCount = 0u;
+	Count m_randomImprovementsCount = 0u;
+	Count m_mutationImprovementsCount = 0u;
+	bool m_improved = false;
+	std::atomic<std::uint64_t>* m_sharedBound = nullptr;
+
+	// Rollouts also advance the virtual clock of the thread
+	void countTests(Count count)
+	{
+		m_testsCount += count;
+		virtualClock.m_rolloutsCount += count;
+	}
+
+	// Orders (step, iteration) like StepIteration, smaller is better, collisionTime is left to the final merge
+	static std::uint64_t getBoundKey(StepIteration const& iteration)
+	{
+		return (static_cast<std::uint64_t>(std::numeric_limits<std::uint32_t>::max() - iteration.m_step) << 32) | iteration.m_iteration;
+	}
+
+	static StepIteration getBoundIteration(std::uint64_t key)
+	{
+		return { std::numeric_limits<std::uint32_t>::max() - static_cast<Step>(key >> 32), static_cast<Iteration>(key & std::numeric_limits<std::uint32_t>::max()), 0. };
+	}
+
+	StepIteration getBound() const
+	{
+		if (!m_sharedBound)
+			return m_best;
+		auto shared = m_sharedBound->load(std::memory_order_relaxed);
+		return shared < getBoundKey(m_best) ? getBoundIteration(shared) : m_best;
+	}
+
+	void improve(Game const& game, IO& io, StepIteration const& iteration, TestSequences&& testSequences, bool mutation)
+	{
+		++(mutation ? m_mutationImprovementsCount : m_randomImprovementsCount);
+		transfer(m_best, iteration, m_bestTestSequences, std::move(testSequences), m_improved, true);
+		if (!m_sharedBound)
+		{
+			logRecordAtLevel(game, RunLevel::Debug, io, mutation ? "mutation bestIteration: " : "random bestIteration: ", m_best);
+			return;
+		}
+		auto key = getBoundKey(iteration);
+		auto shared = m_sharedBound->load(std::memory_order_relaxed);
+		while (key < shared && !m_sharedBound->compare_exchange_weak(shared, key, std::memory_order_relaxed))
+			;
+	}
+};
+
+// Mutations of initialTestSequences and random sequences until limitTimePoint, in batches when m_rolloutsBatchSize allows it
+// Mutations resume from the rollout of initialTestSequences at the first element they change
+template<typename Policy = ConfigPolicy>
+static void searchTestSequences(IO& io, Game const& game, Random& random, State const& currentState, Step targetStep, TestSequences const& initialTestSequences, TimePoint limitTimePoint, SearchSlot& slot)
+{
+	PrefixStates prefixStates(io, game, targetStep, currentState, initialTestSequences);
+	Deadline deadline(game, limitTimePoint);
+	Index firstChange = 0;
+	Count batchSize = std::min(game.m_config.m_rolloutsBatchSize, rolloutsBatchMax) & ~1u;
+	if (batchSize)
+	{
+		std::array<TestSequences, rolloutsBatchMax> candidates;
+		std::array<TestSequencesCursor, rolloutsBatchMax> cursors;
+		std::array<StepIteration, rolloutsBatchMax> iterations;
+		std::array<CompactState, rolloutsBatchMax> states;
+		std::array<double, rolloutsBatchMax> collisionTimes;
+		while (!deadline.isExpired())
+		{
+			// Even lanes hold mutations and odd lanes random sequences, drawn in the same order as the scalar loop below
+			{
+				ScopedTimer timer(Policy::instrument(game.m_config) ? &counters.m_generationDuration : nullptr);
+				for (Index lane = 0; lane < batchSize; lane += 2)
+				{
+					candidates[lane] = mutateTestSequences(game, random, initialTestSequences, firstChange);
+					auto index = prefixStates.getResumeIndex(firstChange);
+					transfer(cursors[lane], TestSequencesCursor{ &candidates[lane], index }, states[lane], prefixStates.m_states[index], collisionTimes[lane], prefixStates.m_collisionTimes[index]);
+					candidates[lane + 1] = getRandomTestSequences(game, random);
+					transfer(cursors[lane + 1], TestSequencesCursor{ &candidates[lane + 1] }, states[lane + 1], prefixStates.m_states[0], collisionTimes[lane + 1], prefixStates.m_collisionTimes[0]);
+				}
+			}
+			{
+				ScopedTimer timer(Policy::instrument(game.m_config) ? &counters.m_simulationDuration : nullptr);
+				reachNextBatch<Policy>(io, game, slot.getBound(), targetStep, getHorizonIteration(game, currentState.m_iteration), states.data(), collisionTimes.data(), cursors.data(), batchSize, iterations.data(), &deadline);
+			}
+			slot.countTests(batchSize);
+			for (Index lane = 0; lane < batchSize; ++lane)
+				if (iterations[lane] < slot.m_best)
+					slot.improve(game, io, iterations[lane], std::move(candidates[lane]), lane % 2 == 0);
+		}
+		return;
+	}
+	auto generationDuration = Policy::instrument(game.m_config) ? &counters.m_generationDuration : nullptr;
+	auto simulationDuration = Policy::instrument(game.m_config) ? &counters.m_simulationDuration : nullptr;
+	while (!deadline.isExpired())
+	{
+		{
+			slot.countTests(1);
+			auto testSequences = timeCall(generationDuration, [&]() { return mutateTestSequences(game, random, initialTestSequences, firstChange); });
+			auto iteration = timeCall(simulationDuration, [&]() { return prefixStates.reachNext<Policy>(io, game, slot.getBound(), targetStep, testSequences, firstChange, &deadline); });
+			if (iteration < slot.m_best)
+				slot.improve(game, io, iteration, std::move(testSequences), true);
+		}
+		{
+			slot.countTests(1);
+			auto testSequences = timeCall(generationDuration, [&]() { return getRandomTestSequences(game, random); });
+			auto iteration = timeCall(simulationDuration, [&]() { return reachNext<Policy>(io, game, slot.getBound(), targetStep, currentState, testSequences, &deadline); });
+			if (iteration < slot.m_best)
+				slot.improve(game, io, iteration, std::move(testSequences), false);
+		}
+	}
+}
+
+// Individuals of the evolution engine, allocated once and kept from turn to turn
+struct Population
+{
+	struct Individual
+	{
+		TestSequences m_testSequences;
+		StepIteration m_iteration;
+	};
+
+	explicit Population(Count size) : m_individuals(std::max(size, 2u))
+	{}
+
+	std::vector<Individual> m_individuals;
+	Count m_carriedCount = 0;
+
+	static bool isBetter(Individual const& lhs, Individual const& rhs)
+	{
+		return lhs.m_iteration < rhs.m_iteration;
+	}
+
+	Index getWorst() const
+	{
+		return std::max_element(m_individuals.begin(), m_individuals.end(), isBetter) - m_individuals.begin();
+	}
+
+	Index select(Random& random, Count tournamentSize) const
+	{
+		auto best = getRandom<Index>(random, 0, m_individuals.size() - 1);
+		for (Count round = 1; round < tournamentSize; ++round)
+		{
+			auto index = getRandom<Index>(random, 0, m_individuals.size() - 1);
+			if (isBetter(m_individuals[index], m_individuals[best]))
+				best = index;
+		}
+		return best;
+	}
+
+	// Replaces the worst individual when iteration beats it, testSequences is then moved from
+	bool replaceWorst(TestSequences& testSequences, StepIteration const& iteration)
+	{
+		auto& worst = m_individuals[getWorst()];
+		if (!(iteration < worst.m_iteration))
+			return false;
+		transfer(worst.m_testSequences, std::move(testSequences), worst.m_iteration, iteration);
+		return true;
+	}
+
+	// Once a command is played, the eliteSize best individuals lose their first command and are carried to the next turn
+	// One individual is always left for the initial sequences of the next turn
+	void shift(Count eliteSize)
+	{
+		m_carriedCount = std::min(eliteSize, static_cast<Count>(m_individuals.size() - 1));
+		std::partial_sort(m_individuals.begin(), m_individuals.begin() + m_carriedCount, m_individuals.end(), isBetter);
+		for (Index index = 0; index < m_carriedCount; ++index)
+		{
+			TestSequencesCursor cursor{ &m_individuals[index].m_testSequences };
+			cursor.advance();
+			m_individuals[index].m_testSequences = cursor.getRemaining();
+		}
+	}
+};
+
+// Steady state evolution until limitTimePoint: offspring of tournament winners, crossed over and mutated, replace the worst individuals they beat
+// The carried elite and the initial sequences are evaluated first, the individuals left unevaluated at the deadline fail
+template<typename Policy = ConfigPolicy>
+static void searchPopulation(IO& io, Game const& game, Random& random, Population& population, State const& currentState, Step targetStep, TestSequences const& initialTestSequences, TimePoint limitTimePoint, SearchSlot& slot)
+{
+	auto& individuals = population.m_individuals;
+	individuals[population.m_carriedCount].m_testSequences = initialTestSequences;
+	for (Index index = population.m_carriedCount + 1; index < individuals.size(); ++index)
+		individuals[index].m_testSequences = getRandomTestSequences(game, random);
+	Deadline deadline(game, limitTimePoint);
+	Count evaluatedCount = 0;
+	for (auto& individual : individuals)
+	{
+		if (deadline.isExpired())
+		{
+			individual.m_iteration = { 0, iterationLimit, 0. };
+			continue;
+		}
+		individual.m_iteration = reachNext<Policy>(io, game, StepIteration(), targetStep, currentState, individual.m_testSequences, &deadline);
+		++evaluatedCount;
+		if (individual.m_iteration < slot.m_best)
+			slot.improve(game, io, individual.m_iteration, TestSequences(individual.m_testSequences), false);
+	}
+	slot.countTests(evaluatedCount);
+
+	Count batchSize = std::max(std::min(game.m_config.m_rolloutsBatchSize, rolloutsBatchMax), 1u);
+	std::array<TestSequences, rolloutsBatchMax> offspring;
+	std::array<StepIteration, rolloutsBatchMax> iterations;
+	Index firstChange = 0;
+	while (!deadline.isExpired())
+	{
+		{
+			ScopedTimer timer(Policy::instrument(game.m_config) ? &counters.m_generationDuration : nullptr);
+			for (Index child = 0; child < batchSize; ++child)
+			{
+				auto const& mother = individuals[population.select(random, game.m_config.m_tournamentSize)].m_testSequences;
+				auto const& father = individuals[population.select(random, game.m_config.m_tournamentSize)].m_testSequences;
+				offspring[child] = mutateTestSequences(game, random, crossTestSequences(random, mother, father), firstChange);
+			}
+		}
+		// Offspring worse than the worst individual are dropped anyway, so it bounds the rollouts
+		{
+			ScopedTimer timer(Policy::instrument(game.m_config) ? &counters.m_simulationDuration : nullptr);
+			reachNextBatch<Policy>(io, game, individuals[population.getWorst()].m_iteration, targetStep, currentState, offspring.data(), batchSize, iterations.data(), &deadline);
+		}
+		slot.countTests(batchSize);
+		for (Index child = 0; child < batchSize; ++child)
+		{
+			if (iterations[child] < slot.m_best)
+				slot.improve(game, io, iterations[child], TestSequences(offspring[child]), true);
+			population.replaceWorst(offspring[child], iterations[child]);
+		}
+	}
+}
+
+// Nodes of the beam search, the frontier and its children live in storage allocated once for the game
+struct BeamArena
+{
+	struct Node
+	{
+		TestSequences m_testSequences;
+		CompactState m_state;
+		double m_collisionTime = 0.;
+		double m_score = 0.;
+	};
+
+	explicit BeamArena(Config const& config)
+	{
+		for (auto type : { TestSequence::Type::Direct, TestSequence::Type::Forced })
+			for (Angle angle : { +angleMax, -angleMax })
+				for (Thrust thrust : { thrustMax, 0u })
+				{
+					if (type == TestSequence::Type::Direct && (angle != +angleMax || thrust != thrustMax))
+						continue;
+					for (Count iterations = 1; iterations <= std::min(config.m_testSequenceIterationsMax, testSequenceIterationsLimit); ++iterations)
+					{
+						TestSequence action;
+						action.m_type = type;
+						if (type == TestSequence::Type::Forced)
+							transfer(action.m_angle, static_cast<std::int8_t>(angle), action.m_thrust, static_cast<std::uint8_t>(thrust));
+						action.m_iterations = static_cast<std::uint8_t>(iterations);
+						m_actions.push_back(action);
+					}
+				}
+		auto width = std::max(config.m_beamWidth, 1u);
+		m_frontier.resize(width);
+		m_children.resize(width * m_actions.size());
+	}
+
+	std::vector<TestSequence> m_actions;
+	std::vector<Node> m_frontier, m_children;
+};
+
+static bool isSameState(CompactState const& lhs, CompactState const& rhs)
+{
+	return lhs.m_x == rhs.m_x && lhs.m_y == rhs.m_y && lhs.m_vx == rhs.m_vx && lhs.m_vy == rhs.m_vy && lhs.m_angle == rhs.m_angle && lhs.m_step == rhs.m_step && lhs.m_iteration == rhs.m_iteration;
+}
+
+// Moves the best of the childrenCount first children to the frontier and returns its size
+// Macro-actions overlap, for instance D1 then D1 reaches the same state as D2, so children equal to an admitted node are skipped,
+// equal states having equal scores, only the admitted nodes of the same score, at the end of the frontier, are compared
+static Count admitChildren(BeamArena& arena, Count childrenCount)
+{
+	auto byScore = [](BeamArena::Node const& lhs, BeamArena::Node const& rhs) { return lhs.m_score < rhs.m_score; };
+	std::sort(arena.m_children.begin(), arena.m_children.begin() + childrenCount, byScore);
+	Count frontierSize = 0;
+	auto isAdmitted = [&arena, &frontierSize](BeamArena::Node const& child)
+	{
+		for (auto index = frontierSize; index-- && arena.m_frontier[index].m_score == child.m_score; )
+			if (isSameState(child.m_state, arena.m_frontier[index].m_state))
+				return true;
+		return false;
+	};
+	for (Index index = 0; index < childrenCount && frontierSize < arena.m_frontier.size(); ++index)
+	{
+		auto const& child = arena.m_children[index];
+		if (!isAdmitted(child))
+			arena.m_frontier[frontierSize++] = child;
+	}
+	return frontierSize;
+}
+
+// Estimated iterations of a node: those spent plus the distance left to the edges of the checkpoints until targetStep at m_beamSpeed
+static double getBeamScore(Game const& game, CompactState const& state, Step targetStep)
+{
+	auto const& checkpoints = game.m_checkpoints;
+	auto distance = std::abs(checkpoints.m_checkpoints[state.m_step] - state.getPosition());
+	for (auto step = state.m_step + 1u; step < targetStep; ++step)
+		distance += checkpoints.m_distances[step];
+	distance = std::max(distance - (targetStep - state.m_step) * checkpointRadius, 0.);
+	return state.m_iteration + distance / game.m_config.m_beamSpeed;
+}
+
+// Deterministic beam search: each level appends every macro-action to the m_beamWidth best nodes, until targetStep, the capacity or limitTimePoint
+template<typename Policy = ConfigPolicy>
+static void searchBeam(IO& io, Game const& game, BeamArena& arena, State const& currentState, Step targetStep, TimePoint limitTimePoint, SearchSlot& slot)
+{
+	Count frontierSize = 1;
+	auto& root = arena.m_frontier[0];
+	transfer(root.m_testSequences, TestSequences(), root.m_state, CompactState(currentState), root.m_collisionTime, currentState.m_collisionTime);
+	Deadline deadline(game, limitTimePoint);
+	for (Count depth = 0; frontierSize && depth < testSequencesCapacity && !deadline.isExpired(); ++depth)
+	{
+		auto bound = slot.getBound();
+		Iteration iterationMax = targetStep == bound.m_step ? bound.m_iteration : iterationLimit;
+		Count childrenCount = 0;
+		for (Index index = 0; index < frontierSize; ++index)
+		{
+			auto const& node = arena.m_frontier[index];
+			for (auto const& action : arena.m_actions)
+			{
+				if (deadline.isExpired())
+					return;
+				auto& child = arena.m_children[childrenCount];
+				transfer(child.m_testSequences, node.m_testSequences, child.m_state, node.m_state, child.m_collisionTime, node.m_collisionTime);
+				child.m_testSequences.push_back(action);
+				TestSequencesCursor cursor{ &child.m_testSequences, node.m_testSequences.size() };
+				while (cursor.m_index < child.m_testSequences.size() && child.m_state.m_step < targetStep && child.m_state.m_iteration < iterationMax)
+				{
+					auto command = popCommand<Policy>(cursor, game, io, child.m_state);
+					child.m_state = command.move(game, child.m_state, child.m_collisionTime);
+					doIfInstrumented(Policy, game) ++counters.m_movesCount;
+				}
+				slot.countTests(1);
+				if (child.m_state.m_step >= targetStep)
+				{
+					StepIteration iteration{ child.m_state.m_step, child.m_state.m_iteration, child.m_collisionTime };
+					if (iteration < slot.m_best)
+						slot.improve(game, io, iteration, TestSequences(child.m_testSequences), false);
+				}
+				else if (child.m_state.m_iteration < iterationMax)
+				{
+					child.m_score = getBeamScore(game, child.m_state, targetStep);
+					++childrenCount;
+				}
+			}
+		}
+		frontierSize = admitChildren(arena, childrenCount);
 	}
 }
 
+// Commands of the whole race, one single-iteration element per iteration, Direct where the direct command was chosen
+struct RacePlan
+{
+	std::vector<TestSequence> m_elements;
+
+	template<typename S>
+	void setCommand(IO& io, Game const& game, S const& state, Command const& command)
+	{
+		auto direct = getDirectCommand(game, io, state, game.m_config.m_speedFactor);
+		TestSequence element{ TestSequence::Type::Direct, 0, 0, 1 };
+		if (command.m_angle != direct.m_angle || command.m_thrust != direct.m_thrust)
+			element = { TestSequence::Type::Forced, static_cast<std::int8_t>(command.m_angle), static_cast<std::uint8_t>(command.m_thrust), 1 };
+		if (m_elements.size() <= state.m_iteration)
+			m_elements.resize(state.m_iteration + 1);
+		m_elements[state.m_iteration] = element;
+	}
+
+	// Replaces the plan from state.m_iteration on with the rollout of testSequences until targetStep, the tail beyond is kept
+	void record(IO& io, Game const& game, State const& initialState, Step targetStep, TestSequences const& testSequences)
+	{
+		CompactState state(initialState);
+		auto collisionTime = initialState.m_collisionTime;
+		TestSequencesCursor cursor{ &testSequences };
+		while (state.m_step < targetStep && state.m_iteration < iterationLimit)
+		{
+			auto command = popCommand(cursor, game, io, state);
+			setCommand(io, game, state, command);
+			state = command.move(game, state, collisionTime);
+			doIfInstrumented(ConfigPolicy, game) ++counters.m_movesCount;
+		}
+	}
+
+	// The plan from iteration on, equal consecutive elements merged, cut when TestSequences is full
+	TestSequences getTestSequences(Iteration iteration) const
+	{
+		TestSequences testSequences;
+		for (Index index = iteration; index < m_elements.size(); ++index)
+		{
+			if (!testSequences.empty() && compareTestSequence(testSequences.back(), m_elements[index]) && testSequences.back().m_iterations < testSequenceIterationsLimit)
+				++testSequences.back().m_iterations;
+			else if (testSequences.full())
+				break;
+			else
+				testSequences.push_back(m_elements[index]);
+		}
+		return testSequences;
+	}
+};
+
+// Plays the whole race on the first turn, every planned turn searching toward its target step with an equal share of the time left
+// The direct run of the remaining race estimates the turns left, the best sequence of each turn is carried to the next one like in runGame
+static void planRace(IO& io, Game const& game, Random& random, State state, TimePoint limitTimePoint, RacePlan& plan)
+{
+	auto stepsCount = game.m_checkpoints.m_checkpoints.size();
+	auto directIteration = reachNext(io, game, StepIteration(), stepsCount, state, TestSequences());
+	Iteration plannedIteration = directIteration.m_step == stepsCount ? directIteration.m_iteration : iterationLimit;
+	TestSequences testSequences;
+	while (state.m_step < stepsCount && state.m_iteration < iterationLimit)
+	{
+		auto turnsCount = plannedIteration > state.m_iteration + 1 ? plannedIteration - state.m_iteration : 1u;
+		auto turnTimePoint = now();
+		if (turnTimePoint < limitTimePoint)
+			turnTimePoint += (limitTimePoint - turnTimePoint) / turnsCount;
+		auto targetStep = game.m_checkpoints.m_targetSteps[state.m_step];
+		SearchSlot slot;
+		transfer(slot.m_best, reachNext(io, game, StepIteration(), targetStep, state, testSequences), slot.m_bestTestSequences, testSequences);
+		searchTestSequences(io, game, random, state, targetStep, testSequences, turnTimePoint, slot);
+		plan.record(io, game, state, targetStep, slot.m_bestTestSequences);
+		TestSequencesCursor cursor{ &slot.m_bestTestSequences };
+		auto command = popCommand(cursor, game, io, state);
+		testSequences = cursor.getRemaining();
+		state = command.move(game, state);
+		doIfInstrumented(ConfigPolicy, game) ++counters.m_movesCount;
+	}
+	// Tails recorded by earlier turns may run past the end of the planned race
+	plan.m_elements.resize(state.m_iteration);
+}
+
+// Threads kept for the whole game and woken up once per turn, the calling thread runs worker 0
+// The job of a turn is a function pointer and its context, so that starting it does not allocate
+struct SearchWorkers
+{
+	using Job = void (*)(void* context, Index worker);
+
+	explicit SearchWorkers(Count threadsCount)
+	{
+		for (Index worker = 1; worker < threadsCount; ++worker)
+			m_threads.emplace_back([this, worker]() { work(worker); });
+	}
+
+	~SearchWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_start.notify_all();
+		for (auto& thread : m_threads)
+			thread.join();
+	}
+
+	Count getThreadsCount() const
+	{
+		return static_cast<Count>(m_threads.size()) + 1;
+	}
+
+	// job lives on the stack of the caller, which waits for every worker to end it
+	template<typename F>
+	void run(F& job)
+	{
+		run([](void* context, Index worker) { (*static_cast<F*>(context))(worker); }, &job);
+	}
+
+	void run(Job job, void* context)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			transfer(m_job, job, m_context, context);
+			m_pending = static_cast<Count>(m_threads.size());
+			++m_generation;
+		}
+		m_start.notify_all();
+		m_job(m_context, 0);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this]() { return !m_pending; });
+	}
+
+	void work(Index worker)
+	{
+		unsigned generation = 0u;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_start.wait(lock, [&]() { return m_stop || m_generation != generation; });
+				if (m_stop)
+					return;
+				generation = m_generation;
+			}
+			m_job(m_context, worker);
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!--m_pending)
+				m_done.notify_one();
+		}
+	}
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_start, m_done;
+	Job m_job = nullptr;
+	void* m_context = nullptr;
+	unsigned m_generation = 0u;
+	Count m_pending = 0u;
+	bool m_stop = false;
+};
+
+// Search time of each turn: m_stepTime scaled up when the best sequence passes a checkpoint within m_transitionTurns,
+// scaled down when the search has not improved it for m_stableTurns, and never past the hard limit of the turn minus
+// the safety margin and the measured overhead, which covers the overrun of the search, the end of the turn and the output
+struct BudgetScheduler
+{
+	using Duration = std::chrono::steady_clock::duration;
+
+	Duration m_overhead = {};
+	Count m_stableTurnsCount = 0u;
+
+	static bool isNearTransition(IO& io, Game const& game, State const& initialState, TestSequences const& testSequences)
+	{
+		CompactState state(initialState);
+		auto collisionTime = initialState.m_collisionTime;
+		TestSequencesCursor cursor{ &testSequences };
+		for (Count turn = 0; turn < game.m_config.m_transitionTurns && state.m_step < game.m_checkpoints.m_checkpoints.size(); ++turn)
+		{
+			state = popCommand(cursor, game, io, state).move(game, state, collisionTime);
+			doIfInstrumented(ConfigPolicy, game) ++counters.m_movesCount;
+			if (state.m_step != initialState.m_step)
+				return true;
+		}
+		return false;
+	}
+
+	// turnTimePoint is when the input line of the turn was received, so that its parsing is taken from the budget,
+	// the first turn keeps the time point of runGame that covers the checkpoints
+	TimePoint getLimitTimePoint(Config const& config, TimePoint turnTimePoint, bool firstTurn, bool nearTransition) const
+	{
+		auto budget = std::chrono::duration_cast<Duration>(firstTurn ? config.m_firstStepTime : config.m_stepTime);
+		if (!firstTurn && nearTransition)
+			budget = std::chrono::duration_cast<Duration>(budget * config.m_transitionBudgetFactor);
+		else if (!firstTurn && m_stableTurnsCount >= config.m_stableTurns)
+			budget = std::chrono::duration_cast<Duration>(budget * config.m_stableBudgetFactor);
+		auto limit = std::chrono::duration_cast<Duration>(firstTurn ? firstStepTime : stepTime) - config.m_budgetMargin - m_overhead;
+		return turnTimePoint + std::max(std::min(budget, limit), Duration::zero());
+	}
+
+	// The overhead decays slowly so that a single slow turn keeps the next ones safe
+	void update(TimePoint limitTimePoint, TimePoint endTimePoint, bool improved)
+	{
+		m_overhead = std::max(std::max(endTimePoint - limitTimePoint, Duration::zero()), m_overhead - m_overhead / 8);
+		m_stableTurnsCount = improved ? 0u : m_stableTurnsCount + 1;
+	}
+};
+
 struct Result
 {
 	Count m_gamesCount = 0u;
@@ -714,12 +2714,22 @@ struct Result
 	Count m_testsCount = 0u;
 	Count m_randomImprovementsCount = 0u;
 	Count m_mutationImprovementsCount = 0u;
+	Counters m_counters;
 };
 
 static Result operator+(Result const& lhs, Result const& rhs)
 {
+	auto sumCounters = lhs.m_counters;
 	return { lhs.m_gamesCount + rhs.m_gamesCount, lhs.m_iterationsCount + rhs.m_iterationsCount, lhs.m_collisionTime + rhs.m_collisionTime, lhs.m_elpased + rhs.m_elpased,
-		lhs.m_testsCount + rhs.m_testsCount, lhs.m_randomImprovementsCount + rhs.m_randomImprovementsCount, lhs.m_mutationImprovementsCount + rhs.m_mutationImprovementsCount };
+		lhs.m_testsCount + rhs.m_testsCount, lhs.m_randomImprovementsCount + rhs.m_randomImprovementsCount, lhs.m_mutationImprovementsCount + rhs.m_mutationImprovementsCount, sumCounters += rhs.m_counters };
+}
+
+static std::ostream& operator<<(std::ostream& os, Counters const& counters)
+{
+	return os << "movesCount=" << counters.m_movesCount << " directCommandsCount=" << counters.m_directCommandsCount << " forcedCommandsCount=" << counters.m_forcedCommandsCount
+		<< " boundAbortsCount=" << counters.m_boundAbortsCount << " prunedRolloutsCount=" << counters.m_prunedRolloutsCount << " allocationsCount=" << counters.m_allocationsCount
+		<< " generation=" << std::chrono::duration_cast<std::chrono::microseconds>(counters.m_generationDuration).count() << "us"
+		<< " simulation=" << std::chrono::duration_cast<std::chrono::microseconds>(counters.m_simulationDuration).count() << "us";
 }
 
 static std::ostream& operator<<(std::ostream& os, Result const& result)
@@ -729,26 +2739,141 @@ static std::ostream& operator<<(std::ostream& os, Result const& result)
 		os  << " averageTestsCount=" << (result.m_testsCount / result.m_iterationsCount)
 			<< " averageRandomImprovementsCount=" << ((100 * result.m_randomImprovementsCount) / result.m_iterationsCount) << "%"
 			<< " averageMutationImprovementsCount=" << ((100 * result.m_mutationImprovementsCount) / result.m_iterationsCount) << "%";
+	if (result.m_counters.m_movesCount)
+		os << " averageMovesCount=" << (static_cast<double>(result.m_counters.m_movesCount) / result.m_iterationsCount)
+			<< " averageAllocationsCount=" << (static_cast<double>(result.m_counters.m_allocationsCount) / result.m_iterationsCount)
+			<< " generationShare=" << (100. * result.m_counters.m_generationDuration.count() / std::max((result.m_counters.m_generationDuration + result.m_counters.m_simulationDuration).count(), std::chrono::nanoseconds::rep(1))) << "%";
 	return os;
 }
 
+// One turn of a trace, fixed-size so that a mapped trace is read in place: the search inputs of the turn, then what it chose and what it cost
+// m_testsCount covers the whole turn, m_searchTestsCount only the search of the workers, without the initial candidates of runGame
+struct TraceRecord
+{
+	State m_state;
+	StepIteration m_initialIteration;
+	TestSequences m_initialTestSequences;
+	Random m_random;
+	std::uint64_t m_rolloutsCount = 0u;
+	std::int64_t m_budget = 0;
+	Command m_command;
+	StepIteration m_bestIteration;
+	std::uint64_t m_testsCount = 0u;
+	std::uint64_t m_searchTestsCount = 0u;
+	std::int64_t m_elapsed = 0;
+	Counters m_counters;
+};
+
+static_assert(std::is_trivially_copyable<TraceRecord>::value, "TraceRecord should be written and read as raw bytes");
+
+const std::uint32_t traceMagic = 0x31525453u;
+
+// A trace is the header, the checkpoints, the configuration as read by readConfig, then the records from an aligned offset
+struct TraceHeader
+{
+	std::uint32_t m_magic = traceMagic;
+	std::uint32_t m_recordSize = sizeof(TraceRecord);
+	std::uint32_t m_checkpointsCount = 0u;
+	std::uint32_t m_configSize = 0u;
+
+	std::size_t getRecordsOffset() const
+	{
+		auto offset = sizeof(TraceHeader) + m_checkpointsCount * sizeof(Z) + m_configSize;
+		return (offset + alignof(TraceRecord) - 1) / alignof(TraceRecord) * alignof(TraceRecord);
+	}
+};
+
+// Records are written and flushed after the output of the turn, a game cut short leaves the records of its complete turns
+struct TraceWriter
+{
+	TraceWriter(std::string const& path, Config const& config, Checkpoints const& checkpoints) : m_os(path, std::ios::binary)
+	{
+		std::ostringstream configText;
+		configText << config;
+		TraceHeader header;
+		header.m_checkpointsCount = static_cast<std::uint32_t>(checkpoints.m_checkpoints.size());
+		header.m_configSize = static_cast<std::uint32_t>(configText.str().size());
+		m_os.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		m_os.write(reinterpret_cast<char const*>(checkpoints.m_checkpoints.data()), header.m_checkpointsCount * sizeof(Z));
+		m_os.write(configText.str().data(), header.m_configSize);
+		std::fill_n(std::ostreambuf_iterator<char>(m_os), header.getRecordsOffset() - sizeof(header) - header.m_checkpointsCount * sizeof(Z) - header.m_configSize, '\0');
+	}
+
+	void write(TraceRecord const& record)
+	{
+		m_os.write(reinterpret_cast<char const*>(&record), sizeof(record));
+		m_os.flush();
+	}
+
+	std::ofstream m_os;
+};
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 static Result runGame(Config const& config, IO& io)
 {
+	// A simulation on the virtual clock starts it at zero, the calling thread gets its own clock back at the end
+	auto callerClock = virtualClock;
+	virtualClock = { config.m_simulation ? config.m_rolloutsPerMillisecond : 0u, 0u };
 	auto startTimepoint = now();
 	Game game;
 	game.m_config = config;
-	logAtLevel(game, RunLevel::Test, io) << "seed=" << seed << std::endl;
+	io.m_echo = game.m_config.m_runLevel <= RunLevel::Debug;
+	logAtLevel(game, RunLevel::Test, io) << "seed=" << seed() + game.m_config.m_seed << std::endl;
 	game.m_checkpoints = Checkpoints::read(io, game.m_config);
-	auto timePoint = now();
+	// The cost-to-go table is built on the time of the first turn
+	auto timePoint = now() - game.m_checkpoints.m_costsToGoDuration;
 	logAtLevel(game, RunLevel::Debug, io) << io.getLastRead() << std::endl;
 	logAtLevel(game, RunLevel::Test, io) << game.m_checkpoints << std::endl;
+	std::unique_ptr<TraceWriter> trace;
+	if (!game.m_config.m_tracePath.empty())
+	{
+		trace = std::make_unique<TraceWriter>(game.m_config.m_tracePath, game.m_config, game.m_checkpoints);
+		if (!trace->m_os)
+		{
+			io.m_err << "Invalid trace file: " << game.m_config.m_tracePath << std::endl;
+			trace.reset();
+		}
+	}
 	State lastState;
 	Result result;
 	result.m_gamesCount = 1;
 
 	TestSequences bestTestSequences;
+	std::unique_ptr<SearchWorkers> workers;
+	if (game.m_config.m_withRandomTests && game.m_config.m_searchThreadsCount > 1)
+		workers = std::make_unique<SearchWorkers>(game.m_config.m_searchThreadsCount);
+	// Stream w always belongs to worker w, so a worker draws the same candidates whatever the threads count
+	std::vector<Random> randoms;
+	std::vector<Population> populations;
+	std::unique_ptr<BeamArena> beamArena;
+	for (Index worker = 0; worker < (workers ? workers->getThreadsCount() : 1u); ++worker)
+	{
+		randoms.emplace_back(seed() + game.m_config.m_seed, worker);
+		if (game.m_config.m_searchEngine == SearchEngine::Evolution)
+			populations.emplace_back(game.m_config.m_populationSize);
+	}
+	if (game.m_config.m_searchEngine == SearchEngine::Beam)
+		beamArena = std::make_unique<BeamArena>(game.m_config);
+	// Slots and counters of the workers, reset every turn
+	std::vector<SearchSlot> slots(workers ? workers->getThreadsCount() : 0u);
+	std::vector<Counters> workersCounters(slots.size());
+	RacePlan racePlan;
+	BudgetScheduler budgetScheduler;
+	// The beam search being deterministic, only worker 0 runs it, the other workers sample test sequences
+	auto search = [&](Index worker, State const& currentState, Step targetStep, TestSequences const& initialTestSequences, TimePoint limitTimePoint, SearchSlot& slot)
+	{
+		dispatchPolicy(game.m_config, [&](auto policy)
+		{
+			using Policy = decltype(policy);
+			if (game.m_config.m_searchEngine == SearchEngine::Evolution)
+				searchPopulation<Policy>(io, game, randoms[worker], populations[worker], currentState, targetStep, initialTestSequences, limitTimePoint, slot);
+			else if (game.m_config.m_searchEngine == SearchEngine::Beam && !worker)
+				searchBeam<Policy>(io, game, *beamArena, currentState, targetStep, limitTimePoint, slot);
+			else
+				searchTestSequences<Policy>(io, game, randoms[worker], currentState, targetStep, initialTestSequences, limitTimePoint, slot);
+		});
+	};
 
 	while (true)
 	{
@@ -756,36 +2881,54 @@ static Result runGame(Config const& config, IO& io)
 		auto currentState = game.m_config.m_simulation && result.m_iterationsCount ? lastState : State::read(io);
 		currentState.m_iteration = result.m_iterationsCount;
 		logAtLevel(game, RunLevel::Debug, io) << io.getLastRead() << std::endl;
-		logAtLevel(game, RunLevel::Test, io) << "old: " << currentState << std::endl;
+		logRecordAtLevel(game, RunLevel::Test, io, "old: ", currentState);
 		doAtLevel(game, RunLevel::Validation)
 			if (result.m_iterationsCount && lastState != currentState)
 			{
 				logDifference(game, io, lastState, currentState);
 				assertAtLevel(game, RunLevel::Validation, false);
 			}
-		TimePoint limitTimePoint = timePoint + (result.m_iterationsCount ? game.m_config.m_stepTime : game.m_config.m_firstStepTime);
+		auto firstTurn = !result.m_iterationsCount;
+		TimePoint limitTimePoint = timePoint + (firstTurn ? game.m_config.m_firstStepTime : game.m_config.m_stepTime);
 		++result.m_iterationsCount;
 		auto targetStep = game.m_checkpoints.m_targetSteps[currentState.m_step];
+		if (game.m_config.m_adaptiveBudget && game.m_config.m_withRandomTests)
+		{
+			auto turnTimePoint = firstTurn ? timePoint : game.m_config.m_simulation ? now() : io.m_lineTimePoint;
+			limitTimePoint = budgetScheduler.getLimitTimePoint(game.m_config, turnTimePoint, firstTurn, BudgetScheduler::isNearTransition(io, game, currentState, bestTestSequences));
+			logAtLevel(game, RunLevel::Test, io) << "budget=" << getMillisecondsElapsed(turnTimePoint, limitTimePoint) << "ms sinceInput=" << getMillisecondsElapsed(turnTimePoint, now())
+				<< "ms overhead=" << std::chrono::duration_cast<std::chrono::milliseconds>(budgetScheduler.m_overhead).count() << "ms" << std::endl;
+		}
 		auto lap = currentState.m_step / lapsCount;
 		auto lapStep = currentState.m_step % lapsCount;
 		Command bestCommand;
 		State bestState;
 
-		logAtLevel(game, RunLevel::Debug, io) << "step=" << currentState.m_step << " targetStep=" << targetStep << " lap=" << lap << " lapStep=" << lapStep << std::endl;
+		logRecordAtLevel(game, RunLevel::Debug, io, "step=", currentState.m_step, " targetStep=", targetStep, " lap=", lap, " lapStep=", lapStep);
 		Count testsCount = 0;
+		bool improved = false;
+		TraceRecord traceRecord;
+		traceRecord.m_state = currentState;
+		auto turnCounters = counters;
+		std::fill(workersCounters.begin(), workersCounters.end(), Counters());
 		if (game.m_config.m_withRandomTests)
 		{
-			auto replaceBest = [&](StepIteration iteration, TestSequences testSequences)
+			auto replaceBest = [&](StepIteration iteration, TestSequences const& testSequences)
 			{
-				auto command = popCommand(testSequences, game, io, currentState);
+				TestSequencesCursor cursor{ &testSequences };
+				auto command = popCommand(cursor, game, io, currentState);
 				auto state = command.move(game, currentState);
-				transfer(bestIteration, std::move(iteration), bestCommand, std::move(command), bestState, std::move(state), bestTestSequences, std::move(testSequences));
-				logAtLevel(game, RunLevel::Debug, io) << "bestIteration: " << bestIteration << " bestState: " << bestState << std::endl;
+				doIfInstrumented(ConfigPolicy, game) ++counters.m_movesCount;
+				transfer(bestIteration, std::move(iteration), bestCommand, std::move(command), bestState, std::move(state), bestTestSequences, cursor.getRemaining());
+				logRecordAtLevel(game, RunLevel::Debug, io, "bestIteration: ", bestIteration, " bestState: ", bestState);
 			};
+			// The plan gets the first turn's time but a normal turn, later turns refine it around the current position
+			if (game.m_config.m_planRace && result.m_iterationsCount == 1)
+				planRace(io, game, randoms[0], currentState, std::max(limitTimePoint - game.m_config.m_stepTime, now()), racePlan);
 			{
 				++testsCount;
 				auto iteration = reachNext(io, game, bestIteration, targetStep, currentState, bestTestSequences);
-				logAtLevel(game, RunLevel::Test, io) << "iteration: " << iteration << " bestIteration: " << bestIteration << std::endl;
+				logRecordAtLevel(game, RunLevel::Test, io, "iteration: ", iteration, " bestIteration: ", bestIteration);
 				assertAtLevel(game, RunLevel::Validation, iteration.m_step != bestIteration.m_step || iteration == bestIteration);
 				if (iteration < bestIteration || iteration == bestIteration)
 				{
@@ -802,42 +2945,84 @@ static Result runGame(Config const& config, IO& io)
 					replaceBest(iteration, std::move(testSequences));
 				}
 			}
-			auto initialTestSequences = bestTestSequences;
-			while (now() < limitTimePoint)
+			if (!racePlan.m_elements.empty())
 			{
+				++testsCount;
+				auto testSequences = racePlan.getTestSequences(currentState.m_iteration);
+				auto iteration = reachNext(io, game, bestIteration, targetStep, currentState, testSequences);
+				if (iteration < bestIteration)
 				{
-					++testsCount;
-					auto testSequences = mutateTestSequences(game, initialTestSequences);
-					auto iteration = reachNext(io, game, bestIteration, targetStep, currentState, testSequences);
-					if (iteration < bestIteration)
-					{
-						++result.m_mutationImprovementsCount;
-						logAtLevel(game, RunLevel::Debug, io) << "mutation ";
-						replaceBest(iteration, std::move(testSequences));
-					}
+					replaceBest(iteration, std::move(testSequences));
 				}
+			}
+			SearchSlot initialSlot;
+			transfer(initialSlot.m_best, bestIteration, initialSlot.m_bestTestSequences, bestTestSequences);
+			auto const& initialTestSequences = initialSlot.m_bestTestSequences;
+			SearchSlot bestSlot = initialSlot;
+			if (trace)
+			{
+				transfer(traceRecord.m_initialIteration, initialSlot.m_best, traceRecord.m_initialTestSequences, initialTestSequences, traceRecord.m_random, randoms[0]);
+				traceRecord.m_rolloutsCount = virtualClock.m_rolloutsCount;
+				traceRecord.m_budget = std::chrono::duration_cast<std::chrono::nanoseconds>(limitTimePoint - now()).count();
+			}
+			if (workers)
+			{
+				// Every thread searches on its own slot, the best one wins and ties go to the lowest worker
+				std::atomic<std::uint64_t> sharedBound(SearchSlot::getBoundKey(bestIteration));
+				std::fill(slots.begin(), slots.end(), initialSlot);
+				auto turnClock = virtualClock;
+				// Worker 0 runs on this thread, whose counters cover the turn
+				auto job = [&](Index worker)
 				{
-					++testsCount;
-					auto testSequences = getRandomTestSequences(game);
-					auto iteration = reachNext(io, game, bestIteration, targetStep, currentState, testSequences);
-					if (iteration < bestIteration)
-					{
-						++result.m_randomImprovementsCount;
-						logAtLevel(game, RunLevel::Debug, io) << "random ";
-						replaceBest(iteration, std::move(testSequences));
-					}
+					if (worker)
+						virtualClock = turnClock;
+					auto workerCounters = counters;
+					slots[worker].m_sharedBound = &sharedBound;
+					search(worker, currentState, targetStep, initialTestSequences, limitTimePoint, slots[worker]);
+					if (worker)
+						workersCounters[worker] = counters - workerCounters;
+				};
+				workers->run(job);
+				for (auto& slot : slots)
+				{
+					bestSlot.m_testsCount += slot.m_testsCount;
+					bestSlot.m_randomImprovementsCount += slot.m_randomImprovementsCount;
+					bestSlot.m_mutationImprovementsCount += slot.m_mutationImprovementsCount;
+					if (slot.m_best < bestSlot.m_best)
+						transfer(bestSlot.m_best, slot.m_best, bestSlot.m_bestTestSequences, std::move(slot.m_bestTestSequences), bestSlot.m_improved, true);
 				}
 			}
+			else
+				search(0, currentState, targetStep, initialTestSequences, limitTimePoint, bestSlot);
+			testsCount += bestSlot.m_testsCount;
+			traceRecord.m_searchTestsCount = bestSlot.m_testsCount;
+			result.m_randomImprovementsCount += bestSlot.m_randomImprovementsCount;
+			result.m_mutationImprovementsCount += bestSlot.m_mutationImprovementsCount;
+			improved = bestSlot.m_improved;
+			if (bestSlot.m_improved)
+				replaceBest(bestSlot.m_best, std::move(bestSlot.m_bestTestSequences));
+			if (!racePlan.m_elements.empty())
+			{
+				racePlan.setCommand(io, game, currentState, bestCommand);
+				racePlan.record(io, game, bestState, targetStep, bestTestSequences);
+			}
 		}
 		else
 		{
 			bestCommand = getDirectCommand(game, io, currentState, game.m_config.m_speedFactor);
 			bestState = bestCommand.move(game, currentState);
+			doIfInstrumented(ConfigPolicy, game) ++counters.m_movesCount;
 		}
-		logAtLevel(game, RunLevel::Test, io) << "testsCount=" << testsCount << " totalRandomImprovements=" << result.m_randomImprovementsCount << " totalMutationImprovements=" << result.m_mutationImprovementsCount
-			<< std::endl << "bestIteration: " << bestIteration << " bestCommand: " << bestCommand << " bestTestSequences: " << bestTestSequences << std::endl;
+		turnCounters = counters - turnCounters;
+		for (auto const& workerCounters : workersCounters)
+			turnCounters += workerCounters;
+		result.m_counters += turnCounters;
+		logRecordAtLevel(game, RunLevel::Test, io, "testsCount=", testsCount, " totalRandomImprovements=", result.m_randomImprovementsCount, " totalMutationImprovements=", result.m_mutationImprovementsCount);
+		if (game.m_config.m_instrument)
+			logRecordAtLevel(game, RunLevel::Test, io, "counters: ", turnCounters);
+		logRecordAtLevel(game, RunLevel::Test, io, "bestIteration: ", bestIteration, " bestCommand: ", bestCommand, " bestTestSequences: ", bestTestSequences);
 		result.m_testsCount += testsCount;
-		logAtLevel(game, RunLevel::Test, io)<< "bestState: " << bestState << std::endl;
+		logRecordAtLevel(game, RunLevel::Test, io, "bestState: ", bestState);
 		bool endGame = bestState.m_step == game.m_checkpoints.m_checkpoints.size() || result.m_iterationsCount == iterationLimit;
 		if (endGame)
 		{
@@ -846,26 +3031,48 @@ static Result runGame(Config const& config, IO& io)
 			logAtLevel(game, RunLevel::PreValidation, io) << result << std::endl;
 		}
 		lastState = bestState;
+		for (auto& population : populations)
+			population.shift(game.m_config.m_eliteSize);
 		io.m_out << bestCommand << std::endl;
-		logAtLevel(game, RunLevel::Test, io) << "elapsed=" << getMillisecondsElapsed(timePoint, now()) << "ms" << std::endl;
+		if (game.m_config.m_adaptiveBudget)
+			budgetScheduler.update(limitTimePoint, now(), improved);
+		if (trace)
+		{
+			transfer(traceRecord.m_command, bestCommand, traceRecord.m_bestIteration, bestIteration, traceRecord.m_testsCount, testsCount, traceRecord.m_counters, turnCounters);
+			traceRecord.m_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now() - timePoint).count();
+			trace->write(traceRecord);
+		}
+		logRecordAtLevel(game, RunLevel::Test, io, "elapsed=", getMillisecondsElapsed(timePoint, now()), "ms");
 		//assertAtLevel(game, RunLevel::Debug, now() - timePoint <= (result.m_iterationsCount <= 1 ? firstLapTime : turnTime));
 		timePoint = now();
 		if (endGame)
 			break;
 	}
+	virtualClock = callerClock;
 	return result;
 }
 
-static void runGame()
+// Logs below Release go through an AsyncLog, so that they are formatted and written out of the turn
+static void runGame(Config const& config)
 {
-	Config config;
 	auto io = IO::make();
-	runGame(config, io);
+	std::unique_ptr<AsyncLog> log;
+	std::unique_ptr<IO> asyncIO;
+	if (config.m_asyncLog && config.m_runLevel < RunLevel::Release)
+	{
+		log = std::make_unique<AsyncLog>(io.m_err);
+		asyncIO = std::make_unique<IO>(IO{ io.m_in, log->m_stream, io.m_out });
+		asyncIO->m_log = log.get();
+	}
+	runGame(config, asyncIO ? *asyncIO : io);
 }
 
 #ifndef TESTS
-int main()
+int main(int argc, char** argv)
 {
-	runGame();
+	Config config;
+	if (!readConfig(argc, argv, config, std::cerr))
+		return 1;
+	runGame(config);
 }
 #endif
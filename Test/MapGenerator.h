@@ -0,0 +1,125 @@
+#pragma once
+
+// Needs the definitions of Main.cpp and Maps.h
+
+// Shapes of the generated laps, besides random ones the adversarial shapes of the built-in maps:
+// hairpins like map 16, zig-zags like map 18 and shuttles between the sides like map 19
+enum class MapShape { Random = 0, Hairpin = 1, Zigzag = 2, Shuttle = 3, Count = 4 };
+
+static char const* getMapShapeName(MapShape shape)
+{
+	static char const* const names[] = { "random", "hairpin", "zigzag", "shuttle" };
+	return names[static_cast<int>(shape)];
+}
+
+const Distance mapMargin = 1000.;
+const Distance mapCheckpointsDistanceMin = 1500.;
+const Count mapLapStepsMin = 3u, mapLapStepsMax = 8u;
+
+// Checkpoints within the margins of the map, the lap size of the built-in maps, no two checkpoints of a lap closer than mapCheckpointsDistanceMin
+static bool isValidLap(std::vector<Z> const& lap)
+{
+	if (lap.size() < mapLapStepsMin || lap.size() > mapLapStepsMax)
+		return false;
+	for (Index index = 0; index < lap.size(); ++index)
+	{
+		if (lap[index].real() < mapMargin || lap[index].real() > xMax - mapMargin || lap[index].imag() < mapMargin || lap[index].imag() > yMax - mapMargin)
+			return false;
+		for (Index other = 0; other < index; ++other)
+			if (std::norm(lap[index] - lap[other]) < mapCheckpointsDistanceMin * mapCheckpointsDistanceMin)
+				return false;
+	}
+	return true;
+}
+
+static Z getRandomMapPoint(Random& random)
+{
+	return { static_cast<Distance>(getRandom<int>(random, static_cast<int>(mapMargin), static_cast<int>(xMax - mapMargin))), static_cast<Distance>(getRandom<int>(random, static_cast<int>(mapMargin), static_cast<int>(yMax - mapMargin))) };
+}
+
+static Z getRandomDirection(Random& random)
+{
+	return getPolar(getRandom<Angle>(random, 0, 359));
+}
+
+// One draw of the shape, isValidLap tells whether it fits
+static std::vector<Z> drawLap(Random& random, MapShape shape)
+{
+	std::vector<Z> lap;
+	if (shape == MapShape::Random)
+	{
+		auto size = getRandom<Count>(random, mapLapStepsMin, mapLapStepsMax);
+		while (lap.size() < size)
+			lap.push_back(getRandomMapPoint(random));
+	}
+	else if (shape == MapShape::Hairpin)
+	{
+		// A tight arc of checkpoints, then a far one from which the race starts
+		auto size = getRandom<Count>(random, 4u, mapLapStepsMax);
+		auto position = getRandomMapPoint(random);
+		auto direction = getRandomDirection(random);
+		auto bend = getPolar(getRandom<Angle>(random, 10, 30) * (getRandomBool(random) ? 1 : -1));
+		for (Index index = 0; index + 1 < size; ++index)
+		{
+			lap.push_back(position);
+			position += static_cast<Distance>(getRandom<int>(random, 1500, 2000)) * direction;
+			direction *= bend;
+		}
+		lap.push_back(getRandomMapPoint(random));
+		if (std::abs(lap.back() - lap.front()) < 5000.)
+			lap.clear();
+	}
+	else if (shape == MapShape::Zigzag)
+	{
+		// Checkpoints alternating on both sides of an axis, then one on the axis before the first from which the race starts
+		auto size = getRandom<Count>(random, 5u, mapLapStepsMax);
+		auto start = getRandomMapPoint(random);
+		auto axis = getRandomDirection(random);
+		auto step = static_cast<Distance>(getRandom<int>(random, 1400, 1800));
+		auto offset = static_cast<Distance>(getRandom<int>(random, 400, 800)) * axis * 1i;
+		for (Index index = 0; index + 1 < size; ++index)
+			lap.push_back(start + static_cast<Distance>(index) * step * axis + (index % 2 ? -offset : offset));
+		lap.push_back(start - static_cast<Distance>(getRandom<int>(random, 1500, 2500)) * axis);
+	}
+	else if (shape == MapShape::Shuttle)
+	{
+		// Checkpoints alternating between the left and right sides, with half turns at each of them
+		auto size = getRandom<Count>(random, 4u, mapLapStepsMax);
+		auto jitter = static_cast<int>(mapMargin);
+		for (Index index = 0; index < size; ++index)
+		{
+			auto x = index % 2 ? xMax - mapMargin - getRandom<int>(random, 0, jitter) : mapMargin + getRandom<int>(random, 0, jitter);
+			lap.push_back({ x, static_cast<Distance>(getRandom<int>(random, static_cast<int>(mapMargin), static_cast<int>(yMax - mapMargin))) });
+		}
+	}
+	for (auto& checkpoint : lap)
+		checkpoint = { std::round(checkpoint.real()), std::round(checkpoint.imag()) };
+	return lap;
+}
+
+static std::vector<Z> generateLap(Random& random, MapShape shape)
+{
+	while (true)
+	{
+		auto lap = drawLap(random, shape);
+		if (isValidLap(lap))
+			return lap;
+	}
+}
+
+// Map index of the corpus of seed, in the input format of the bot: lapsCount laps, the race starting at rest on the last checkpoint
+static GameInput generateMap(std::uint64_t seed, std::uint64_t index)
+{
+	Random random(seed, index);
+	auto shape = static_cast<MapShape>(getRandom<int>(random, 0, static_cast<int>(MapShape::Count) - 1));
+	auto lap = generateLap(random, shape);
+	GameInput input;
+	input.m_label = std::string(getMapShapeName(shape)) + "-" + std::to_string(index);
+	input.m_checkpoints = std::to_string(lap.size() * lapsCount) + " \n";
+	for (Count lapIndex = 0; lapIndex < lapsCount; ++lapIndex)
+		for (auto const& checkpoint : lap)
+			input.m_checkpoints += std::to_string(static_cast<int>(checkpoint.real())) + " " + std::to_string(static_cast<int>(checkpoint.imag())) + " \n";
+	auto const& start = lap.back();
+	input.m_initialState = "0 " + std::to_string(static_cast<int>(start.real())) + " " + std::to_string(static_cast<int>(start.imag())) + " 0 0 " + std::to_string(getRandom<Angle>(random, 0, 359)) + " \n";
+	return input;
+}
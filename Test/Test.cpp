@@ -1,10 +1,19 @@
 #include "pch.h"
 #include <atomic>
+#include <deque>
+#include <future>
 #include <regex>
+#include <set>
 #include <thread>
 
 #define TESTS
+#define COUNT_ALLOCATIONS
 #include "../Main/Main.cpp"
+#include "Maps.h"
+#include "MapGenerator.h"
+#include "ThreadPool.h"
+#include "TraceReader.h"
+#include "../Batch/Batch.h"
 
 const double degEpsilon = .1;
 
@@ -22,12 +31,16 @@ static std::string toString(T&& t)
 	return s.str();
 }
 
-struct GameInput
+static std::string getConfigValue(Config const& config, std::string const& name)
 {
-	std::string m_label;
-	std::string m_checkpoints;
-	std::string m_initialState;
-};
+	std::ostringstream os;
+	visitConfig(config, [&](char const* memberName, auto const& member)
+		{
+			if (name == memberName)
+				writeConfigValue(os, member);
+		});
+	return os.str();
+}
 
 struct TestIO
 {
@@ -45,6 +58,18 @@ struct TestIO
 	IO m_io;
 };
 
+// Values of a parameter of Config explored by the tuner, by its name in configuration files
+struct ParameterRange
+{
+	std::string m_name;
+	double m_min = 0.;
+	double m_max = 0.;
+	double m_step = 0.;
+};
+
+// Configuration read by the Simulations test when present in the working directory, one name=value per line
+static char const* const configPath = "SearchRace.config";
+
 struct SearchRaceTest : public ::testing::Test
 {
 	SearchRaceTest()
@@ -57,31 +82,46 @@ struct SearchRaceTest : public ::testing::Test
 		//m_config.m_withRandomTests = false;
 		//m_config.m_runLevel = RunLevel::Test;
 		//m_config.m_runLevel = RunLevel::Debug;
-		m_testParameters = true;
+		m_tuneParameters = true;
 		//m_specificTest = "1";
 		//m_config.m_speedFactor = 0.;
 		//m_config.m_directCommandVersion = 0;
+		//m_config.m_rolloutsPerMillisecond = 1000u;
 
-		m_maxThreadsCount = 2u;
+		m_threadsCount = std::max(std::thread::hardware_concurrency(), 1u);
+		//m_pinThreads = true;
 		m_runsCount = 4u;
+		m_parameterRanges = { { "speedFactor", 3.3, 3.8, .1 }, { "radiusFactor", 0., 1., .1 }, { "targetDistance", 1800., 2400., 100. } };
+		m_candidatesCount = 81u;
+		m_halvingFactor = 3u;
 
 		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+		adjustRuns();
+	}
+
+	// One thread when the games log and one run when they are deterministic
+	void adjustRuns()
+	{
 		if (m_config.m_runLevel < RunLevel::Validation || !m_config.m_withRandomTests)
 		{
-			m_maxThreadsCount = 1u;
+			m_threadsCount = 1u;
 			m_runsCount = 1u;
 		}
 		if (!m_specificTest.empty())
 		{
-			m_maxThreadsCount = 1u;
+			m_threadsCount = 1u;
 		}
 	}
 
 	Config m_config;
-	Count m_maxThreadsCount = 0, m_runsCount = 0;
-	bool m_testParameters = false;
+	Count m_threadsCount = 0, m_runsCount = 0;
+	bool m_pinThreads = false;
+	bool m_tuneParameters = false;
+	std::vector<ParameterRange> m_parameterRanges;
+	Count m_candidatesCount = 0, m_halvingFactor = 0;
 	std::string m_specificTest;
+	std::unique_ptr<ThreadPool> m_pool;
 
 	Result runGame(TestIO& io, GameInput const& input)
 	{
@@ -89,69 +129,99 @@ struct SearchRaceTest : public ::testing::Test
 		return ::runGame(m_config, io.m_io);
 	}
 
-	static void simulateGame(SearchRaceTest* test, TestIO* io, GameInput const& input, Result* result, Result* resultWithoutRandomTests)
+	// Game of input read with config, state receives its initial state
+	Game readGame(TestIO& io, GameInput const& input, State& state, Config const& config)
 	{
-		for (unsigned run = 0u; run < test->m_runsCount; ++run)
-			*result = *result + test->runGame(*io, input);
-		if (test->m_config.m_withRandomTests)
-		{
-			test->m_config.m_withRandomTests = false;
-			*resultWithoutRandomTests = *resultWithoutRandomTests + test->runGame(*io, input);
-			test->m_config.m_withRandomTests = true;
-		}
+		io.m_in.str(input.m_checkpoints + input.m_initialState);
+		Game game;
+		game.m_config = config;
+		game.m_checkpoints = Checkpoints::read(io.m_io, game.m_config);
+		state = State::read(io.m_io);
+		return game;
 	}
 
-	struct RunInput
+	Game readGame(TestIO& io, GameInput const& input, State& state)
 	{
-		RunInput(SearchRaceTest& test, GameInput const& input) : m_test(test), m_input(input), m_done(false) {}
+		return readGame(io, input, state, m_config);
+	}
 
-		RunInput(RunInput&&) = default;
-		RunInput& operator=(RunInput&&) = default;
+	// Runs of one map with one configuration, each of them is a job of the pool and the last one to end signals the completion
+	struct RunInput
+	{
+		RunInput(Config const& config, GameInput const& input, Count runsCount)
+			: m_config(config), m_input(input), m_results(runsCount), m_remainingCount(runsCount), m_done(m_promise.get_future())
+		{}
 
-		SearchRaceTest& m_test;
-		TestIO m_io;
+		Config m_config;
 		GameInput const& m_input;
-		Result m_result;
-		Result m_resultWithoutRandomTests;
-		bool m_done;
+		// Runs with random tests, one per seed, then the run without random tests if m_config has them
+		std::vector<Result> m_results;
+		std::atomic<Count> m_remainingCount;
+		std::promise<void> m_promise;
+		std::future<void> m_done;
+
+		Result getResult() const
+		{
+			Result result;
+			for (Index run = 0; run < m_results.size() - (m_config.m_withRandomTests ? 1 : 0); ++run)
+				result = result + m_results[run];
+			return result;
+		}
+
+		Result getResultWithoutRandomTests() const
+		{
+			return m_config.m_withRandomTests ? m_results.back() : Result();
+		}
 	};
 
-	static void simulateGames(std::vector<RunInput>* runInputs, std::atomic<unsigned>* atomicIndex)
+	void submitRuns(RunInput& runInput)
 	{
-		auto next = [&]() { return atomicIndex->fetch_add(1); };
-		auto index = next();
-		while (index < runInputs->size())
+		auto runGame = [&runInput](Index run, Config const& config)
+		{
+			TestIO io;
+			io.m_in.str(runInput.m_input.m_checkpoints + runInput.m_input.m_initialState);
+			runInput.m_results[run] = ::runGame(config, io.m_io);
+			if (!--runInput.m_remainingCount)
+				runInput.m_promise.set_value();
+		};
+		for (Index run = 0; run < m_runsCount; ++run)
 		{
-			auto& runInput = (*runInputs)[index];
-			simulateGame(&runInput.m_test, &runInput.m_io, runInput.m_input, &runInput.m_result, &runInput.m_resultWithoutRandomTests);
-			runInput.m_done = true;
-			index = next();
+			auto config = runInput.m_config;
+			config.m_seed = run;
+			getPool().submit([runGame, run, config]() { runGame(run, config); });
+		}
+		if (runInput.m_config.m_withRandomTests)
+		{
+			auto config = runInput.m_config;
+			config.m_withRandomTests = false;
+			getPool().submit([runGame, run = m_runsCount, config]() { runGame(run, config); });
 		}
 	}
 
-	static void displayResults(std::vector<RunInput>* runInputs, bool intermediaryResults, bool intermediaryChecks, bool withRandomTests)
+	template<typename Iterator>
+	static void displayResults(Iterator begin, Iterator end, bool intermediaryResults, bool intermediaryChecks, bool withRandomTests)
 	{
+		TestIO io;
 		Result result, resultWithoutRandomTests;
-		for (auto const& runInput : *runInputs)
+		for (auto runInput = begin; runInput != end; ++runInput)
 		{
-			while (!runInput.m_done)
-				std::this_thread::yield();
+			runInput->m_done.wait();
+			auto runResult = runInput->getResult();
 			if (intermediaryResults)
 			{
-				runInput.m_io.m_io.m_err << "Test(" << runInput.m_input.m_label << "): " << runInput.m_result << std::endl;
+				io.m_io.m_err << "Test(" << runInput->m_input.m_label << "): " << runResult << std::endl;
 				if (withRandomTests)
-					runInput.m_io.m_io.m_err << "Test(" << runInput.m_input.m_label << "): " << runInput.m_resultWithoutRandomTests << " [non random]" << std::endl;
+					io.m_io.m_err << "Test(" << runInput->m_input.m_label << "): " << runInput->getResultWithoutRandomTests() << " [non random]" << std::endl;
 			}
 			if (intermediaryChecks)
 			{
-				EXPECT_LE(runInput.m_result.m_elpased, firstStepTime.count() + (runInput.m_result.m_iterationsCount - 1) * stepTime.count()) << "Check elapsed on test " << runInput.m_input.m_label << " failed!";
-				EXPECT_LT((runInput.m_result.m_iterationsCount / runInput.m_result.m_gamesCount), iterationLimit) << "Check final iteration on test " << runInput.m_input.m_label << " failed!";
+				EXPECT_LE(runResult.m_elpased, firstStepTime.count() + (runResult.m_iterationsCount - 1) * stepTime.count()) << "Check elapsed on test " << runInput->m_input.m_label << " failed!";
+				EXPECT_LT((runResult.m_iterationsCount / runResult.m_gamesCount), iterationLimit) << "Check final iteration on test " << runInput->m_input.m_label << " failed!";
 			}
-			result = result + runInput.m_result;
-			resultWithoutRandomTests = resultWithoutRandomTests + runInput.m_resultWithoutRandomTests;
+			result = result + runResult;
+			resultWithoutRandomTests = resultWithoutRandomTests + runInput->getResultWithoutRandomTests();
 		}
 
-		TestIO io;
 		if (intermediaryResults)
 			io.m_io.m_err << "------ " << std::endl;
 		io.m_io.m_err << "Tests: " << result << std::endl;
@@ -161,64 +231,97 @@ struct SearchRaceTest : public ::testing::Test
 		EXPECT_LT((result.m_iterationsCount / result.m_gamesCount), iterationLimit);
 	}
 
-	void runGames(std::vector<GameInput> const& inputs, bool intermediaryResults = true)
+	ThreadPool& getPool()
 	{
-		std::vector<RunInput> runInputs;
+		if (!m_pool)
+			m_pool = std::make_unique<ThreadPool>(m_threadsCount <= 1 ? 0 : m_threadsCount, m_pinThreads);
+		return *m_pool;
+	}
+
+	// All the runs of maps x seeds are submitted at once, the results are displayed map by map as they complete
+	void runGames(std::vector<GameInput> const& inputs)
+	{
+		std::deque<RunInput> runInputs;
 		for (auto const& input : inputs)
 			if (m_specificTest.empty() || m_specificTest == input.m_label)
-				runInputs.emplace_back(*this, input);
+				submitRuns(runInputs.emplace_back(m_config, input, m_runsCount + (m_config.m_withRandomTests ? 1 : 0)));
+		displayResults(runInputs.begin(), runInputs.end(), true, true, m_config.m_withRandomTests);
+	}
 
-		std::atomic<unsigned> atomicIndex = 0u;
-		std::vector<std::thread> threads(m_maxThreadsCount <= 1 ? 0 : m_maxThreadsCount);
-		if (threads.empty())
-			simulateGames(&runInputs, &atomicIndex);
-		else
-			for (auto& thread : threads)
-				thread = std::thread(simulateGames, &runInputs, &atomicIndex);
+	// Average iterations count of the games, the lower the better
+	static double getScore(Result const& result)
+	{
+		return result.m_gamesCount ? (result.m_collisionTime + result.m_iterationsCount) / result.m_gamesCount : getInfinity<double>();
+	}
 
-		if (threads.empty())
-			displayResults(&runInputs, intermediaryResults, !m_testParameters, m_config.m_withRandomTests);
-		else
-			threads.push_back(std::thread(displayResults, &runInputs, intermediaryResults, !m_testParameters, m_config.m_withRandomTests));
-		for (auto& thread : threads)
-			if (thread.joinable())
-				thread.join();
+	struct Candidate
+	{
+		Config m_config;
+		Result m_result;
+	};
+
+	void displayCandidate(std::ostream& os, Candidate const& candidate) const
+	{
+		for (auto const& range : m_parameterRanges)
+			os << " " << range.m_name << "=" << getConfigValue(candidate.m_config, range.m_name);
+		os << " " << candidate.m_result << std::endl;
 	}
 
-	void testParameters(std::vector<GameInput> const& inputs)
+	// Successive halving over m_candidatesCount configs drawn in m_parameterRanges: each rung runs the remaining candidates on more maps,
+	// all of them concurrently, and keeps the best 1 / m_halvingFactor of them on all the maps run so far, the last rung runs every map
+	// and ranks the finalists
+	void tuneParameters(std::vector<GameInput> const& inputs)
 	{
+		Random random;
+		std::vector<GameInput> maps;
+		for (auto const& input : inputs)
+			if (m_specificTest.empty() || m_specificTest == input.m_label)
+				maps.push_back(input);
+		// Maps in random order, so that the first rungs do not only see the smallest ones
+		for (Index map = maps.size(); map > 1; --map)
+			std::swap(maps[map - 1], maps[getRandom<Index>(random, 0, map - 1)]);
+
+		std::vector<Candidate> candidates(m_candidatesCount, { m_config, {} });
+		for (auto& candidate : candidates)
+			for (auto const& range : m_parameterRanges)
+			{
+				auto stepsCount = static_cast<Count>(std::round((range.m_max - range.m_min) / range.m_step));
+				EXPECT_TRUE(setConfigValue(candidate.m_config, range.m_name, toString(range.m_min + getRandom<Count>(random, 0, stepsCount) * range.m_step))) << range.m_name;
+			}
+
+		Count rungsCount = 0;
+		for (Count count = m_candidatesCount; count > 1; count = (count + m_halvingFactor - 1) / m_halvingFactor)
+			++rungsCount;
+		rungsCount = std::max(rungsCount, 1u);
 		TestIO io;
-		io.m_io.m_err << "------ " << std::endl;
-		//for (m_config.m_testSequencesSizeMax = 2u; m_config.m_testSequencesSizeMax <= 4; ++m_config.m_testSequencesSizeMax)
+		Count mapsCount = 0;
+		for (Index rung = 0; rung < rungsCount; ++rung)
 		{
-			//for (m_config.m_testSequenceIterationsMax = 4u; m_config.m_testSequenceIterationsMax <= 6u; m_config.m_testSequenceIterationsMax += 1)
-			{
-				//for (m_config.m_targetStep = 2u; m_config.m_targetStep <= 4u; m_config.m_targetStep += 1)
+			auto rungMapsCount = static_cast<Count>(std::ceil(maps.size() / std::pow(m_halvingFactor, rungsCount - 1 - rung)));
+			std::deque<RunInput> runInputs;
+			for (auto& candidate : candidates)
+				for (Index map = mapsCount; map < rungMapsCount; ++map)
+					submitRuns(runInputs.emplace_back(candidate.m_config, maps[map], m_runsCount + (candidate.m_config.m_withRandomTests ? 1 : 0)));
+			auto runInput = runInputs.begin();
+			for (auto& candidate : candidates)
+				for (Index map = mapsCount; map < rungMapsCount; ++map, ++runInput)
 				{
-					//for (m_config.m_directCommandVersion = 0; m_config.m_directCommandVersion <= 1; m_config.m_directCommandVersion += 1)
-					{
-						for (m_config.m_speedFactor = 3.3; m_config.m_speedFactor <= 3.8; m_config.m_speedFactor += .1)
-						{
-							//for (int useDisksOfRotation = 1; useDisksOfRotation >= 0; m_config.m_useDisksOfRotation = !!--useDisksOfRotation)
-							{
-								for (m_config.m_radiusFactor = 0.; m_config.m_radiusFactor <= 1.; m_config.m_radiusFactor += .1)
-								{
-									for (m_config.m_targetDistance = 1800; m_config.m_targetDistance <= 2400.; m_config.m_targetDistance += 100.)
-									{
-										io.m_io.m_err << std::fixed << std::setprecision(2) << " testSequenceIterationsMax=" << m_config.m_testSequenceIterationsMax << " testSequencesSizeMax=" << m_config.m_testSequencesSizeMax << " targetStep=" << m_config.m_targetStep
-											<< " directCommandVersion=" << m_config.m_directCommandVersion << " speedFactor=" << std::setprecision(2) << m_config.m_speedFactor
-											<< " useDisksOfRotation=" << m_config.m_useDisksOfRotation << " radiusFactor=" << m_config.m_radiusFactor << " targetDistance=" << m_config.m_targetDistance << std::endl;
-										runGames(inputs, false);
-										io.m_io.m_err << "------ " << std::endl;
-									}
-								}
-							}
-						}
-					}
+					runInput->m_done.wait();
+					candidate.m_result = candidate.m_result + runInput->getResult();
 				}
-			}
+			mapsCount = std::max(mapsCount, rungMapsCount);
+
+			std::stable_sort(candidates.begin(), candidates.end(), [](Candidate const& lhs, Candidate const& rhs) { return getScore(lhs.m_result) < getScore(rhs.m_result); });
+			io.m_io.m_err << "------ rung=" << rung << " candidatesCount=" << candidates.size() << " mapsCount=" << mapsCount << std::endl;
+			for (auto const& candidate : candidates)
+				displayCandidate(io.m_io.m_err, candidate);
+			if (rung + 1 < rungsCount)
+				candidates.resize((candidates.size() + m_halvingFactor - 1) / m_halvingFactor);
 		}
+		io.m_io.m_err << "------ " << std::endl << "Best:" << std::endl << candidates.front().m_config;
+		EXPECT_LT(getScore(candidates.front().m_result), iterationLimit);
 	}
+
 };
 
 TEST_F(SearchRaceTest, ReadGameInput)
@@ -238,6 +341,10 @@ TEST_F(SearchRaceTest, ReadGameInput)
 	EXPECT_EQ(state.m_position, Z(10353, 1986));
 	EXPECT_EQ(state.m_speed, Z(0, 0));
 	EXPECT_EQ(state.m_angle, 161);
+	io.m_io.m_echo = false;
+	io.m_in.str(stateInput);
+	EXPECT_EQ(State::read(io.m_io), state);
+	EXPECT_EQ(io.m_io.getLastRead(), "");
 }
 
 TEST_F(SearchRaceTest, WriteCommand)
@@ -248,14 +355,34 @@ TEST_F(SearchRaceTest, WriteCommand)
 
 TEST_F(SearchRaceTest, RandomCommand)
 {
+	Random random;
 	for (unsigned i = 0; i < 100; ++i)
 	{
-		auto c = Command::getRandom();
+		auto c = Command::getRandom(random);
 		EXPECT_LE(std::abs(c.m_angle), angleMax);
 		EXPECT_LE(c.m_thrust, thrustMax);
 	}
 }
 
+TEST_F(SearchRaceTest, RandomStreams)
+{
+	Random random1(7u, 1u), random1Again(7u, 1u), random2(7u, 2u);
+	bool differ = false;
+	for (unsigned i = 0; i < 100; ++i)
+	{
+		auto draw = random1.next();
+		EXPECT_EQ(draw, random1Again.next());
+		differ |= draw != random2.next();
+	}
+	EXPECT_TRUE(differ);
+
+	std::vector<Count> counts(3, 0);
+	for (unsigned i = 0; i < 30000; ++i)
+		++counts[getRandom<int, -1, +1>(random1) + 1];
+	for (auto count : counts)
+		EXPECT_NEAR(count, 10000, 500);
+}
+
 TEST_F(SearchRaceTest, Polar)
 {
 	EXPECT_LE(std::abs(getPolar(- 90) - (-1.i)), epsilon);
@@ -265,6 +392,53 @@ TEST_F(SearchRaceTest, Polar)
 	EXPECT_LE(std::abs(getPolar(+270) - (-1.i)), epsilon);
 	EXPECT_LE(std::abs(getPolar(+360) - (+1. )), epsilon);
 	EXPECT_LE(std::abs(getPolar(+450) - (+1.i)), epsilon);
+
+	// The compile time table is correctly rounded, the standard library may be one ulp away on near ties
+	for (Angle angle = 0; angle < 360; ++angle)
+	{
+		auto polar = std::polar(1., radByDeg * angle);
+		EXPECT_LE(std::abs(polar.real() - polarTable.m_cos[angle]), std::abs(std::nextafter(polar.real(), 2.) - polar.real())) << angle;
+		EXPECT_LE(std::abs(polar.imag() - polarTable.m_sin[angle]), std::abs(std::nextafter(polar.imag(), 2.) - polar.imag())) << angle;
+	}
+	for (Angle angle = -1000; angle <= 1000; ++angle)
+	{
+		EXPECT_EQ(get360Angle(angle), (angle % 360 + 360) % 360);
+		EXPECT_EQ(get180Angle(angle), (angle % 360 + 540) % 360 - 180);
+	}
+}
+
+TEST_F(SearchRaceTest, FastAngles)
+{
+	// Every integer and half integer target in the box, as produced by the Direct controller with a speed factor of 3.5
+	for (int x = -800; x <= 800; ++x)
+		for (int y = -800; y <= 800; ++y)
+			for (double half : { 0., .5 })
+			{
+				Z target(x + half, y + half);
+				Angle angle = ((x * 7 + y * 13) % 360 + 360) % 360;
+				ASSERT_EQ(getRoundedAngleTo(target, angle), static_cast<Angle>(std::round(std::arg(target) * degByRad - angle))) << target << " " << angle;
+			}
+	for (unsigned k = 0; k <= 1u << 16; ++k)
+	{
+		double u = k / static_cast<double>(1u << 16);
+		Z target(std::cos(k * .01) * 1000., std::sin(k * .01) * 1000.);
+		Angle angle = k % 360;
+		double sign = k % 2 ? 1. : -1.;
+		auto aimedAngle = std::arg(target) * degByRad;
+		aimedAngle += (90. - (u < 1. ? std::acos(u) * degByRad : 0.)) * sign;
+		ASSERT_EQ(getRoundedAimedAngle(target, u, sign, angle), static_cast<Angle>(std::round(aimedAngle - angle))) << target << " " << u;
+	}
+	for (int x = -3000; x <= 3000; x += 50)
+		for (int y = -3000; y <= 3000; y += 50)
+			for (Z speed : { Z(0., 0.), Z(300., -200.), Z(-700., 100.) })
+			{
+				Z point(x, y);
+				Z halfNext = .5 * speed;
+				Z diskRadius = 1.i * speed * halfInverseTanHalfAngleMax;
+				auto disksRadius = std::abs(speed) * halfInverseSinHalfAngleMax;
+				bool isOut = std::abs(point - (halfNext + diskRadius)) - checkpointRadius > disksRadius && std::abs(point - (halfNext - diskRadius)) - checkpointRadius > disksRadius;
+				ASSERT_EQ(isOutDisksOfRotation(Z(), speed, point, checkpointRadius), isOut) << point << " " << speed;
+			}
 }
 
 #if 0
@@ -290,50 +464,699 @@ TEST_F(SearchRaceTest, Transfer)
 	EXPECT_EQ(d, -2.);
 }
 
+TEST_F(SearchRaceTest, AsyncLog)
+{
+	State state(3, { 1234., 5678. }, { -123., 456. }, 161);
+	StepIteration iteration{ 4, 37, .25 };
+	std::ostringstream expected;
+	{
+		IO io{ std::cin, expected, std::cout };
+		io.logRecord("bestIteration: ", iteration, " bestState: ", state);
+		io.m_err << "text " << 42 << std::endl;
+		io.logRecord("elapsed=", 12u, "ms");
+	}
+	std::ostringstream drained;
+	{
+		AsyncLog log(drained);
+		IO io{ std::cin, log.m_stream, std::cout };
+		io.m_log = &log;
+		io.logRecord("bestIteration: ", iteration, " bestState: ", state);
+		io.m_err << "text " << 42 << std::endl;
+		io.logRecord("elapsed=", 12u, "ms");
+	}
+	EXPECT_EQ(drained.str(), expected.str());
+
+	// A full ring drops records, every one of them is either written or reported
+	std::ostringstream small;
+	{
+		AsyncLog log(small, 1);
+		for (unsigned i = 0; i < 1000; ++i)
+			log.push("x");
+	}
+	Count written = 0, dropped = 0;
+	std::istringstream lines(small.str());
+	for (std::string line; std::getline(lines, line);)
+		if (line == "x")
+			++written;
+		else
+			dropped += std::stoul(line.substr(line.find(' ') + 1));
+	EXPECT_EQ(written + dropped, 1000u);
+}
+
+TEST_F(SearchRaceTest, CompactState)
+{
+	TestIO io;
+	State state;
+	auto game = readGame(io, gameInputs[0], state);
+	CompactState compactState(state);
+	Random random;
+	while (state.m_step < game.m_checkpoints.m_checkpoints.size() && state.m_iteration < iterationLimit)
+	{
+		auto directCommand = getDirectCommand(game, io.m_io, state, game.m_config.m_speedFactor);
+		EXPECT_EQ(toString(directCommand), toString(getDirectCommand(game, io.m_io, compactState, game.m_config.m_speedFactor)));
+		auto command = state.m_iteration % 3 ? Command::getRandom(random) : directCommand;
+		double collisionTime = 0.;
+		state = command.move(game, state);
+		compactState = command.move(game, compactState, collisionTime);
+		EXPECT_EQ(state, compactState.getState(collisionTime)) << state;
+		EXPECT_EQ(state.m_collisionTime, collisionTime) << state;
+	}
+}
+
+TEST_F(SearchRaceTest, BatchedRollouts)
+{
+	TestIO io;
+	State state;
+	auto game = readGame(io, gameInputs[0], state);
+	Random random;
+	while (state.m_step < game.m_checkpoints.m_checkpoints.size())
+	{
+		auto targetStep = game.m_checkpoints.m_targetSteps[state.m_step];
+		for (Count size = 1; size <= rolloutsBatchMax; size += 5)
+		{
+			StepIteration stepIterationMax = size % 2 ? StepIteration() : StepIteration{ targetStep, state.m_iteration + size, .5 };
+			std::array<TestSequences, rolloutsBatchMax> testSequences, rollouts;
+			std::array<StepIteration, rolloutsBatchMax> iterations;
+			std::generate_n(testSequences.begin(), size, [&]() { return getRandomTestSequences(game, random); });
+			rollouts = testSequences;
+			reachNextBatch(io.m_io, game, stepIterationMax, targetStep, state, rollouts.data(), size, iterations.data());
+			for (Index lane = 0; lane < size; ++lane)
+				EXPECT_EQ(iterations[lane], reachNext(io.m_io, game, stepIterationMax, targetStep, state, testSequences[lane])) << "lane " << lane << " " << state;
+		}
+		state = getDirectCommand(game, io.m_io, state, game.m_config.m_speedFactor).move(game, state);
+	}
+}
+
+TEST_F(SearchRaceTest, Policies)
+{
+	TestIO io;
+	auto config = m_config;
+	config.m_runLevel = RunLevel::Release;
+	State state;
+	auto game = readGame(io, gameInputs[0], state, config);
+	Config debugConfig;
+	debugConfig.m_runLevel = RunLevel::Debug;
+	EXPECT_FALSE(ReleasePolicy::isAtLevel(debugConfig, RunLevel::Validation));
+	EXPECT_TRUE(ConfigPolicy::isAtLevel(debugConfig, RunLevel::Validation));
+
+	for (unsigned version = 0; version < 2; ++version)
+	{
+		game.m_config.m_directCommandVersion = version;
+		bool dispatched = false;
+		dispatchPolicy(game.m_config, [&](auto policy)
+		{
+			using Policy = decltype(policy);
+			dispatched = !std::is_same<Policy, ConfigPolicy>::value;
+			EXPECT_EQ(Policy::getDirectCommandVersion(game.m_config), version);
+			Random random;
+			auto targetStep = game.m_checkpoints.m_targetSteps[state.m_step];
+			for (unsigned i = 0; i < 50; ++i)
+			{
+				auto testSequences = getRandomTestSequences(game, random);
+				EXPECT_EQ(reachNext<Policy>(io.m_io, game, StepIteration(), targetStep, state, testSequences), reachNext(io.m_io, game, StepIteration(), targetStep, state, testSequences));
+			}
+		});
+		EXPECT_TRUE(dispatched);
+	}
+	game.m_config.m_runLevel = RunLevel::Validation;
+	dispatchPolicy(game.m_config, [](auto policy) { EXPECT_TRUE((std::is_same<decltype(policy), ConfigPolicy>::value)); });
+}
+
+TEST_F(SearchRaceTest, PrefixStates)
+{
+	// With a horizon, resumed rollouts must still be scored at the horizon
+	for (Count rolloutHorizon : { 0u, 6u })
+	{
+		TestIO io;
+		auto config = m_config;
+		config.m_rolloutHorizon = rolloutHorizon;
+		State state;
+		auto game = readGame(io, gameInputs[0], state, config);
+		Random random;
+		while (state.m_step < game.m_checkpoints.m_checkpoints.size())
+		{
+			auto targetStep = game.m_checkpoints.m_targetSteps[state.m_step];
+			auto initialTestSequences = getRandomTestSequences(game, random);
+			PrefixStates prefixStates(io.m_io, game, targetStep, state, initialTestSequences);
+			EXPECT_LE(prefixStates.m_states.size(), initialTestSequences.size() + 1);
+			for (unsigned i = 0; i < 20; ++i)
+			{
+				StepIteration stepIterationMax = i % 2 ? StepIteration() : StepIteration{ targetStep, state.m_iteration + 5 * i, .5 };
+				Index firstChange = 0;
+				auto testSequences = mutateTestSequences(game, random, initialTestSequences, firstChange);
+				for (Index index = 0; index < firstChange; ++index)
+					EXPECT_EQ(testSequences[index], initialTestSequences[index]);
+				EXPECT_EQ(prefixStates.reachNext(io.m_io, game, stepIterationMax, targetStep, testSequences, firstChange), reachNext(io.m_io, game, stepIterationMax, targetStep, state, testSequences)) << state;
+			}
+			state = getDirectCommand(game, io.m_io, state, game.m_config.m_speedFactor).move(game, state);
+		}
+	}
+}
+
+TEST_F(SearchRaceTest, PrunedRollouts)
+{
+	TestIO io;
+	State state;
+	auto game = readGame(io, gameInputs[0], state);
+	Game unprunedGame = game;
+	unprunedGame.m_config.m_pruneRollouts = false;
+	Random random;
+	Count pruned = 0;
+	while (state.m_step < game.m_checkpoints.m_checkpoints.size())
+	{
+		auto targetStep = game.m_checkpoints.m_targetSteps[state.m_step];
+		for (unsigned i = 0; i < 40; ++i)
+		{
+			auto testSequences = getRandomTestSequences(game, random);
+			StepIteration stepIterationMax = i % 4 ? StepIteration{ targetStep, state.m_iteration + 2 * i, .5 } : StepIteration();
+			auto unprunedIteration = reachNext(io.m_io, unprunedGame, stepIterationMax, targetStep, state, testSequences);
+			EXPECT_EQ(reachNext(io.m_io, game, stepIterationMax, targetStep, state, testSequences), unprunedIteration) << state;
+			auto iterationMax = targetStep == stepIterationMax.m_step ? stepIterationMax.m_iteration : iterationLimit;
+			if (!canReach(game, CompactState(state), targetStep, iterationMax))
+			{
+				EXPECT_EQ(unprunedIteration.m_iteration, iterationLimit) << state;
+				++pruned;
+			}
+		}
+		state = getDirectCommand(game, io.m_io, state, game.m_config.m_speedFactor).move(game, state);
+	}
+	EXPECT_GT(pruned, 0u);
+}
+
+TEST_F(SearchRaceTest, CostToGo)
+{
+	TestIO io;
+	auto config = m_config;
+	config.m_rolloutHorizon = 6;
+	State state;
+	auto game = readGame(io, gameInputs[0], state, config);
+	auto const& checkpoints = game.m_checkpoints;
+	EXPECT_EQ(checkpoints.m_costsToGo.size(), checkpoints.m_stepsByLap * Checkpoints::costToGoCells * checkpoints.m_costToGoSteps);
+	EXPECT_LT(std::count(checkpoints.m_costsToGo.begin(), checkpoints.m_costsToGo.end(), Checkpoints::costToGoIterationsMax), checkpoints.m_costsToGo.size() / 100);
+	EXPECT_TRUE(std::is_sorted(checkpoints.m_directIterations.begin(), checkpoints.m_directIterations.end()));
+	EXPECT_LT(checkpoints.m_directIterations.back(), iterationLimit);
+
+	Game exactGame = game;
+	exactGame.m_config.m_rolloutHorizon = 0;
+	Random random;
+	while (state.m_step < checkpoints.m_checkpoints.size())
+	{
+		auto targetStep = checkpoints.m_targetSteps[state.m_step];
+		for (unsigned i = 0; i < 20; ++i)
+		{
+			auto testSequences = getRandomTestSequences(game, random);
+			auto exactIteration = reachNext(io.m_io, exactGame, StepIteration(), targetStep, state, testSequences);
+			auto iteration = reachNext(io.m_io, game, StepIteration(), targetStep, state, testSequences);
+			if (exactIteration.m_iteration <= state.m_iteration + game.m_config.m_rolloutHorizon)
+				EXPECT_EQ(iteration, exactIteration) << state;
+			else
+			{
+				EXPECT_EQ(iteration.m_step, targetStep) << state;
+				EXPECT_GT(iteration.m_iteration, state.m_iteration + game.m_config.m_rolloutHorizon) << state;
+			}
+		}
+		state = getDirectCommand(game, io.m_io, state, game.m_config.m_speedFactor).move(game, state);
+	}
+}
+
+TEST_F(SearchRaceTest, Deadline)
+{
+	TestIO io;
+	State state;
+	auto game = readGame(io, gameInputs[0], state);
+
+	Deadline future(game, now() + std::chrono::hours(1));
+	for (unsigned i = 0; i < 100; ++i)
+		EXPECT_FALSE(future.isExpired());
+	Deadline past(game, now() - std::chrono::milliseconds(1));
+	EXPECT_TRUE(past.isExpired());
+	EXPECT_TRUE(past.isExpired());
+
+	// A whole race takes more than deadlineMoves moves, the expired deadline interrupts it
+	auto stepsCount = game.m_checkpoints.m_checkpoints.size();
+	TestSequences testSequences;
+	auto iteration = reachNext(io.m_io, game, StepIteration(), stepsCount, state, testSequences);
+	EXPECT_EQ(iteration.m_step, stepsCount);
+	EXPECT_GT(iteration.m_iteration, deadlineMoves);
+	EXPECT_EQ(reachNext(io.m_io, game, StepIteration(), stepsCount, state, testSequences, &future), iteration);
+	EXPECT_EQ(reachNext(io.m_io, game, StepIteration(), stepsCount, state, testSequences, &past).m_iteration, iterationLimit);
+
+	std::array<TestSequences, 2> rollouts;
+	std::array<StepIteration, 2> iterations;
+	reachNextBatch(io.m_io, game, StepIteration(), stepsCount, state, rollouts.data(), 2, iterations.data(), &past);
+	EXPECT_EQ(iterations[0].m_iteration, iterationLimit);
+	EXPECT_EQ(iterations[1].m_iteration, iterationLimit);
+}
+
+TEST_F(SearchRaceTest, TestSequencesCursor)
+{
+	TestIO io;
+	State state;
+	auto game = readGame(io, gameInputs[0], state);
+	Random random;
+	auto testSequences = getRandomTestSequences(game, random);
+	auto copy = testSequences;
+	EXPECT_EQ(toString(copy), toString(testSequences));
+	testSequences.insert(testSequences.begin() + 1, { TestSequence::Type::Forced, -angleMax, 0, 2 });
+	testSequences.erase(testSequences.begin() + 1);
+	EXPECT_EQ(toString(copy), toString(testSequences));
+
+	Count total = std::accumulate(testSequences.begin(), testSequences.end(), 0u, [](Count sum, TestSequence const& testSequence) { return sum + testSequence.m_iterations; });
+	TestSequencesCursor cursor{ &testSequences };
+	Count popped = 0;
+	for (; popped < total; ++popped)
+	{
+		auto remaining = cursor.getRemaining();
+		EXPECT_EQ(std::accumulate(remaining.begin(), remaining.end(), 0u, [](Count sum, TestSequence const& testSequence) { return sum + testSequence.m_iterations; }), total - popped);
+		popCommand(cursor, game, io.m_io, state);
+	}
+	EXPECT_TRUE(cursor.getRemaining().empty());
+	EXPECT_EQ(toString(copy), toString(testSequences));
+}
+
+TEST_F(SearchRaceTest, EvolutionEngine)
+{
+	Game game;
+	game.m_config = m_config;
+	Random random;
+	for (unsigned i = 0; i < 100; ++i)
+	{
+		auto mother = getRandomTestSequences(game, random);
+		auto father = getRandomTestSequences(game, random);
+		auto child = crossTestSequences(random, mother, father);
+		bool found = false;
+		for (Index split = 0; split <= std::min(child.size(), mother.size()) && !found; ++split)
+			found = child.size() - split <= father.size()
+				&& std::equal(child.begin(), child.begin() + split, mother.begin())
+				&& std::equal(child.begin() + split, child.end(), father.end() - (child.size() - split));
+		EXPECT_TRUE(found) << child << " from " << mother << " and " << father;
+	}
+
+	// The elite is carried without its first command, one individual is always left for the initial sequences
+	Population population(6u);
+	for (Index index = 0; index < population.m_individuals.size(); ++index)
+		population.m_individuals[index] = { getRandomTestSequences(game, random), { 1, static_cast<Iteration>(10 + (index * 5) % 6), 0. } };
+	auto individuals = population.m_individuals;
+	std::sort(individuals.begin(), individuals.end(), Population::isBetter);
+	// A large tournament ends up with the best individual
+	EXPECT_EQ(population.m_individuals[population.select(random, 1000u)].m_iteration.m_iteration, 10u);
+	population.shift(3u);
+	EXPECT_EQ(population.m_carriedCount, 3u);
+	for (Index index = 0; index < population.m_carriedCount; ++index)
+	{
+		TestSequencesCursor cursor{ &individuals[index].m_testSequences };
+		cursor.advance();
+		EXPECT_EQ(population.m_individuals[index].m_iteration.m_iteration, individuals[index].m_iteration.m_iteration);
+		EXPECT_EQ(toString(population.m_individuals[index].m_testSequences), toString(cursor.getRemaining()));
+	}
+	population.shift(6u);
+	EXPECT_EQ(population.m_carriedCount, 5u);
+
+	// A child replaces the worst individual only when it beats it
+	auto worst = population.getWorst();
+	auto child = getRandomTestSequences(game, random);
+	auto childCopy = child;
+	EXPECT_FALSE(population.replaceWorst(child, population.m_individuals[worst].m_iteration));
+	EXPECT_TRUE(population.replaceWorst(child, { 1, 9, 0. }));
+	EXPECT_EQ(toString(population.m_individuals[worst].m_testSequences), toString(childCopy));
+	EXPECT_EQ(population.m_individuals[worst].m_iteration.m_iteration, 9u);
+
+	// Past the deadline, the individuals are not evaluated and fail
+	{
+		TestIO io;
+		State state;
+		auto evolutionGame = readGame(io, gameInputs[0], state);
+		Population large(1000);
+		SearchSlot slot;
+		searchPopulation(io.m_io, evolutionGame, random, large, state, evolutionGame.m_checkpoints.m_targetSteps[state.m_step], getRandomTestSequences(evolutionGame, random), now(), slot);
+		EXPECT_EQ(slot.m_testsCount, 0u);
+		EXPECT_EQ(large.m_individuals.back().m_iteration.m_iteration, iterationLimit);
+	}
+
+	m_config.m_searchEngine = SearchEngine::Evolution;
+	m_config.m_stepTime = m_config.m_firstStepTime = std::chrono::milliseconds(2);
+	TestIO io;
+	auto result = runGame(io, gameInputs[0]);
+	EXPECT_LT(result.m_iterationsCount, iterationLimit);
+}
+
+TEST_F(SearchRaceTest, BeamSearch)
+{
+	TestIO io;
+	auto config = m_config;
+	config.m_beamWidth = 16;
+	State state;
+	auto game = readGame(io, gameInputs[0], state, config);
+	BeamArena arena(game.m_config);
+	auto targetStep = game.m_checkpoints.m_targetSteps[state.m_step];
+	std::array<SearchSlot, 2> slots;
+	for (auto& slot : slots)
+		searchBeam(io.m_io, game, arena, state, targetStep, now() + std::chrono::seconds(10), slot);
+	EXPECT_TRUE(slots[0].m_improved);
+	EXPECT_EQ(slots[0].m_best, slots[1].m_best);
+	EXPECT_EQ(toString(slots[0].m_bestTestSequences), toString(slots[1].m_bestTestSequences));
+	EXPECT_EQ(slots[0].m_best, reachNext(io.m_io, game, StepIteration(), targetStep, state, slots[0].m_bestTestSequences));
+
+	// A duplicate is skipped even when another node of the same score is admitted between them
+	CompactState first(state), second(state);
+	second.m_x += 1;
+	for (Index index = 0; index < 4; ++index)
+		transfer(arena.m_children[index].m_state, index % 2 ? second : first, arena.m_children[index].m_score, 1.);
+	arena.m_children[4].m_state = first;
+	arena.m_children[4].m_score = 2.;
+	EXPECT_EQ(admitChildren(arena, 5u), 3u);
+
+	// With several threads, the workers other than worker 0 sample test sequences
+	m_config.m_searchEngine = SearchEngine::Beam;
+	m_config.m_searchThreadsCount = 2u;
+	m_config.m_stepTime = m_config.m_firstStepTime = std::chrono::milliseconds(2);
+	TestIO threadsIO;
+	auto result = runGame(threadsIO, gameInputs[0]);
+	EXPECT_LT(result.m_iterationsCount, iterationLimit);
+	EXPECT_GT(result.m_mutationImprovementsCount, 0u);
+}
+
+TEST_F(SearchRaceTest, RacePlan)
+{
+	TestIO io;
+	State state;
+	auto game = readGame(io, gameInputs[0], state);
+	Random random;
+	RacePlan plan;
+	planRace(io.m_io, game, random, state, now() + std::chrono::milliseconds(200), plan);
+	ASSERT_FALSE(plan.m_elements.empty());
+	EXPECT_LT(plan.m_elements.size(), iterationLimit);
+
+	// Replaying the plan element by element runs the planned race to its end
+	while (state.m_step < game.m_checkpoints.m_checkpoints.size() && state.m_iteration < plan.m_elements.size())
+	{
+		auto testSequences = plan.getTestSequences(state.m_iteration);
+		EXPECT_FALSE(testSequences.empty());
+		TestSequencesCursor cursor{ &testSequences };
+		state = popCommand(cursor, game, io.m_io, state).move(game, state);
+	}
+	EXPECT_EQ(state.m_step, game.m_checkpoints.m_checkpoints.size());
+	EXPECT_EQ(state.m_iteration, plan.m_elements.size());
+}
+
+TEST_F(SearchRaceTest, BudgetScheduler)
+{
+	using namespace std::chrono;
+	Config config;
+	config.m_stepTime = milliseconds(40);
+	BudgetScheduler scheduler;
+	TimePoint start;
+	EXPECT_EQ(scheduler.getLimitTimePoint(config, start, true, false) - start, config.m_firstStepTime);
+	EXPECT_EQ(scheduler.getLimitTimePoint(config, start, false, false) - start, config.m_stepTime);
+	EXPECT_EQ(scheduler.getLimitTimePoint(config, start, false, true) - start, duration_cast<BudgetScheduler::Duration>(config.m_stepTime * config.m_transitionBudgetFactor));
+
+	for (unsigned turn = 0; turn < config.m_stableTurns; ++turn)
+		scheduler.update(start, start, false);
+	EXPECT_EQ(scheduler.getLimitTimePoint(config, start, false, false) - start, duration_cast<BudgetScheduler::Duration>(config.m_stepTime * config.m_stableBudgetFactor));
+	scheduler.update(start, start, true);
+	EXPECT_EQ(scheduler.m_stableTurnsCount, 0u);
+
+	// The measured overhead and the margin are kept before the hard limit, the overhead decaying turn after turn
+	config.m_transitionBudgetFactor = 2.;
+	scheduler.update(start, start + milliseconds(8), true);
+	EXPECT_EQ(scheduler.getLimitTimePoint(config, start, false, true) - start, stepTime - config.m_budgetMargin - milliseconds(8));
+	scheduler.update(start, start, true);
+	EXPECT_EQ(scheduler.m_overhead, milliseconds(7));
+
+	// A turn starts when its input line is received, its parsing is on the budget
+	TestIO io;
+	io.m_in.str("1 2 3 4 5 6\n");
+	auto callerClock = virtualClock;
+	virtualClock = { 1u, 5u };
+	auto state = State::read(io.m_io);
+	virtualClock = callerClock;
+	EXPECT_EQ(state.m_step, 1u);
+	EXPECT_EQ(io.m_io.m_lineTimePoint, TimePoint(milliseconds(5)));
+}
+
+TEST_F(SearchRaceTest, VirtualClock)
+{
+	m_config.m_rolloutsPerMillisecond = 100u;
+	m_config.m_firstStepTime = std::chrono::milliseconds(20);
+	m_config.m_stepTime = std::chrono::milliseconds(2);
+	auto const& input = gameInputs[0];
+	TestIO io, otherIO;
+	auto result = runGame(io, input);
+	auto otherResult = runGame(otherIO, input);
+	EXPECT_EQ(io.m_out.str(), otherIO.m_out.str());
+	EXPECT_EQ(result.m_iterationsCount, otherResult.m_iterationsCount);
+	EXPECT_EQ(result.m_testsCount, otherResult.m_testsCount);
+	// Every turn runs its budget of rollouts, overrun by at most the rollouts between two readings of the clock
+	auto budget = (m_config.m_firstStepTime + (result.m_iterationsCount - 1) * m_config.m_stepTime).count() * m_config.m_rolloutsPerMillisecond;
+	EXPECT_GE(result.m_testsCount, budget);
+	EXPECT_LE(result.m_testsCount, budget + result.m_iterationsCount * (m_config.m_deadlineCheckInterval + 3) * m_config.m_rolloutsBatchSize);
+	EXPECT_EQ(virtualClock.m_rolloutsPerMillisecond, 0u);
+}
+
+TEST_F(SearchRaceTest, ConfigValues)
+{
+	Config config;
+	EXPECT_TRUE(setConfigValue(config, "speedFactor", "2.5"));
+	EXPECT_EQ(config.m_speedFactor, 2.5);
+	EXPECT_TRUE(setConfigValue(config, "stepTime", "12"));
+	EXPECT_EQ(config.m_stepTime, std::chrono::milliseconds(12));
+	EXPECT_TRUE(setConfigValue(config, "searchEngine", "2"));
+	EXPECT_EQ(config.m_searchEngine, SearchEngine::Beam);
+	EXPECT_TRUE(setConfigValue(config, "withRandomTests", "false"));
+	EXPECT_FALSE(config.m_withRandomTests);
+	EXPECT_FALSE(setConfigValue(config, "speedFactor", "fast"));
+	EXPECT_FALSE(setConfigValue(config, "speed", "1"));
+	EXPECT_EQ(config.m_speedFactor, 2.5);
+	EXPECT_EQ(getConfigValue(config, "stepTime"), "12");
+
+	std::istringstream is("# comment\n\n targetDistance = 2100\nrunLevel=1\nunknown=3\n");
+	std::ostringstream err;
+	EXPECT_FALSE(readConfig(is, config, err));
+	EXPECT_EQ(config.m_targetDistance, 2100.);
+	EXPECT_EQ(config.m_runLevel, RunLevel::Test);
+	EXPECT_EQ(err.str(), "Invalid configuration: unknown=3\n");
+
+	std::istringstream spaced("\ttracePath = /tmp/search race.trace \r\n");
+	EXPECT_TRUE(readConfig(spaced, config, err));
+	EXPECT_EQ(config.m_tracePath, "/tmp/search race.trace");
+
+	Config read;
+	std::istringstream written(toString(config));
+	EXPECT_TRUE(readConfig(written, read, err));
+	EXPECT_EQ(toString(read), toString(config));
+
+	char const* argv[] = { "Main", "beamWidth=64", "seed=7" };
+	EXPECT_TRUE(readConfig(3, argv, read, err));
+	EXPECT_EQ(read.m_beamWidth, 64u);
+	EXPECT_EQ(read.m_seed, 7u);
+}
+
+TEST_F(SearchRaceTest, BatchRunner)
+{
+	std::string gamesInput;
+	for (Index game = 0; game < 3; ++game)
+		gamesInput += gameInputs[game].m_checkpoints + gameInputs[game].m_initialState + "\n";
+	std::istringstream is(gamesInput);
+	std::string gameInput;
+	EXPECT_TRUE(readGameInput(is, gameInput));
+	EXPECT_EQ(gameInput, gameInputs[0].m_checkpoints + gameInputs[0].m_initialState);
+
+	m_config.m_rolloutsPerMillisecond = 100u;
+	m_config.m_firstStepTime = m_config.m_stepTime = std::chrono::milliseconds(1);
+	std::istringstream games(gamesInput);
+	std::ostringstream records;
+	bool valid = false;
+	{
+		ThreadPool pool(2);
+		BatchRunner runner(m_config, pool, records, 1u);
+		EXPECT_EQ(runner.run(games, valid), 3u);
+	}
+	EXPECT_TRUE(valid);
+	std::istringstream lines(records.str());
+	std::set<std::string> gameFields;
+	for (std::string line; std::getline(lines, line);)
+	{
+		EXPECT_EQ(line.front(), '{');
+		EXPECT_EQ(line.back(), '}');
+		EXPECT_NE(line.find("\"iterations\":"), std::string::npos);
+		gameFields.insert(line.substr(0, line.find(',')));
+	}
+	EXPECT_EQ(gameFields, (std::set<std::string>{ "{\"game\":0", "{\"game\":1", "{\"game\":2" }));
+
+	std::istringstream truncated(gameInputs[0].m_checkpoints);
+	ThreadPool pool(0);
+	BatchRunner runner(m_config, pool, records, 1u);
+	EXPECT_EQ(runner.run(truncated, valid), 0u);
+	EXPECT_FALSE(valid);
+}
+
+TEST_F(SearchRaceTest, MapGenerator)
+{
+	auto map = generateMap(3u, 5u);
+	EXPECT_EQ(generateMap(3u, 5u).m_checkpoints, map.m_checkpoints);
+	EXPECT_EQ(generateMap(3u, 5u).m_initialState, map.m_initialState);
+	EXPECT_NE(generateMap(3u, 6u).m_checkpoints, map.m_checkpoints);
+	EXPECT_NE(generateMap(4u, 5u).m_checkpoints, map.m_checkpoints);
+
+	std::set<std::string> shapes;
+	for (Index index = 0; index < 200; ++index)
+	{
+		auto input = generateMap(0u, index);
+		shapes.insert(input.m_label.substr(0, input.m_label.find('-')));
+		TestIO io;
+		io.m_in.str(input.m_checkpoints + input.m_initialState);
+		auto checkpoints = Checkpoints::read(io.m_io, m_config);
+		auto const& points = checkpoints.m_checkpoints;
+		ASSERT_EQ(points.size(), checkpoints.m_stepsByLap * lapsCount);
+		std::vector<Z> lap(points.begin(), points.begin() + checkpoints.m_stepsByLap);
+		EXPECT_TRUE(isValidLap(lap));
+		for (Index step = checkpoints.m_stepsByLap; step < points.size(); ++step)
+			EXPECT_EQ(points[step], points[step - checkpoints.m_stepsByLap]);
+		auto state = State::read(io.m_io);
+		EXPECT_EQ(state.m_position, lap.back());
+	}
+	EXPECT_EQ(shapes, (std::set<std::string>{ "random", "hairpin", "zigzag", "shuttle" }));
+
+	m_config.m_withRandomTests = false;
+	m_config.m_rolloutsPerMillisecond = 100u;
+	m_config.m_firstStepTime = m_config.m_stepTime = std::chrono::milliseconds(1);
+	for (Index index = 0; index < 4; ++index)
+	{
+		TestIO io;
+		auto result = runGame(io, generateMap(0u, index));
+		EXPECT_LT(result.m_iterationsCount, iterationLimit);
+	}
+}
+
+TEST_F(SearchRaceTest, SearchWorkers)
+{
+	// The threads are kept from one run to the next, and starting a run does not allocate
+	SearchWorkers workers(3u);
+	std::array<std::atomic<Count>, 3> runs = {};
+	// A context larger than the small buffer of std::function
+	std::array<Count, 8> increments = { 1u, 1u, 1u, 1u, 1u, 1u, 1u, 1u };
+	auto job = [&runs, increments](Index worker) { runs[worker] += increments[worker]; };
+	auto allocationsCount = counters.m_allocationsCount;
+	for (unsigned turn = 0; turn < 2; ++turn)
+		workers.run(job);
+	EXPECT_EQ(counters.m_allocationsCount, allocationsCount);
+	for (auto const& run : runs)
+		EXPECT_EQ(run, 2u);
+}
+
+TEST_F(SearchRaceTest, Counters)
+{
+	m_config.m_rolloutsPerMillisecond = 100u;
+	m_config.m_firstStepTime = m_config.m_stepTime = std::chrono::milliseconds(2);
+	TestIO io;
+	auto result = runGame(io, gameInputs[0]);
+	EXPECT_EQ(result.m_counters.m_movesCount, 0u);
+	EXPECT_GT(result.m_counters.m_allocationsCount, 0u);
+
+	m_config.m_instrument = true;
+	m_config.m_runLevel = RunLevel::Release;
+	dispatchPolicy(m_config, [](auto policy) { EXPECT_TRUE((std::is_same_v<decltype(policy), ConfigPolicy>)); });
+	TestIO instrumentedIO;
+	auto instrumented = runGame(instrumentedIO, gameInputs[0]);
+	EXPECT_EQ(instrumentedIO.m_out.str(), io.m_out.str());
+	auto const& counters = instrumented.m_counters;
+	// Rollouts take several moves, each of them after a popped command
+	EXPECT_GT(counters.m_movesCount, instrumented.m_testsCount);
+	EXPECT_GE(counters.m_directCommandsCount + counters.m_forcedCommandsCount, counters.m_movesCount);
+	EXPECT_GT(counters.m_forcedCommandsCount, 0u);
+	EXPECT_GT(counters.m_boundAbortsCount + counters.m_prunedRolloutsCount, 0u);
+	EXPECT_GT(counters.m_generationDuration.count(), 0);
+	EXPECT_GT(counters.m_simulationDuration.count(), 0);
+	EXPECT_EQ((result + instrumented).m_counters.m_movesCount, counters.m_movesCount);
+
+	// The moves caching the prefix states are counted as well
+	State state;
+	auto game = readGame(io, gameInputs[0], state);
+	Random random;
+	auto movesCount = ::counters.m_movesCount;
+	PrefixStates prefixStates(io.m_io, game, game.m_checkpoints.m_targetSteps[state.m_step], state, getRandomTestSequences(game, random));
+	EXPECT_GE(::counters.m_movesCount - movesCount, prefixStates.m_states.back().m_iteration - state.m_iteration);
+	EXPECT_GT(::counters.m_movesCount, movesCount);
+}
+
+TEST_F(SearchRaceTest, TraceReplay)
+{
+	m_config.m_rolloutsPerMillisecond = 100u;
+	m_config.m_firstStepTime = m_config.m_stepTime = std::chrono::milliseconds(2);
+	m_config.m_tracePath = "SearchRace.trace";
+	TestIO io;
+	auto result = runGame(io, gameInputs[0]);
+	{
+		TraceReader trace(m_config.m_tracePath);
+		ASSERT_TRUE(trace.isValid());
+		EXPECT_EQ(toString(trace.m_config), toString(m_config));
+		ASSERT_EQ(trace.getRecordsCount(), result.m_iterationsCount);
+		std::istringstream commands(io.m_out.str());
+		std::string command;
+		for (Index turn = 0; turn < trace.getRecordsCount(); ++turn)
+		{
+			std::getline(commands, command);
+			EXPECT_EQ(toString(trace.getRecord(turn).m_command), command);
+			EXPECT_EQ(trace.getRecord(turn).m_state.m_iteration, turn);
+		}
+		auto game = trace.getGame(io.m_io, trace.m_config);
+		EXPECT_EQ(game.m_checkpoints.m_checkpoints, trace.m_checkpoints);
+		// On the virtual clock, a turn replays exactly as it ran
+		for (Index turn : { 0u, trace.getRecordsCount() / 2, trace.getRecordsCount() - 1 })
+		{
+			auto const& record = trace.getRecord(turn);
+			auto slot = replayTurn(io.m_io, game, record);
+			EXPECT_EQ(slot.m_best, record.m_bestIteration);
+			EXPECT_EQ(slot.m_testsCount, record.m_searchTestsCount);
+			EXPECT_LT(record.m_searchTestsCount, record.m_testsCount);
+		}
+	}
+	std::remove(m_config.m_tracePath.c_str());
+	EXPECT_FALSE(TraceReader(m_config.m_tracePath).isValid());
+
+	// A trace which cannot be written is reported, the game is played anyway
+	auto config = m_config;
+	config.m_tracePath = "/";
+	std::istringstream in(gameInputs[0].m_checkpoints + gameInputs[0].m_initialState);
+	std::ostringstream err, out;
+	IO invalidIO{ in, err, out };
+	EXPECT_EQ(::runGame(config, invalidIO).m_iterationsCount, result.m_iterationsCount);
+	EXPECT_NE(err.str().find("Invalid trace file: /"), std::string::npos);
+}
+
+TEST_F(SearchRaceTest, ThreadPool)
+{
+	std::atomic<Count> count = 0u;
+	{
+		ThreadPool pool(0);
+		pool.submit([&count]() { ++count; });
+		EXPECT_EQ(count, 1u);
+	}
+	std::vector<std::promise<std::thread::id>> promises(64);
+	{
+		ThreadPool pool(3, true);
+		EXPECT_EQ(pool.getThreadsCount(), 3u);
+		for (auto& promise : promises)
+			pool.submit([&count, &promise]() { ++count; promise.set_value(std::this_thread::get_id()); });
+		for (auto& promise : promises)
+			EXPECT_NE(promise.get_future().get(), std::this_thread::get_id());
+		for (Index job = 0; job < 1000; ++job)
+			pool.submit([&count]() { ++count; });
+	}
+	EXPECT_EQ(count, 1u + 64u + 1000u);
+}
+
 TEST_F(SearchRaceTest, Simulations)
 {
-	std::vector<GameInput> const& inputs = {
-		{ "1", "9 \n2757 4659 \n3358 2838 \n10353 1986 \n2757 4659 \n3358 2838 \n10353 1986 \n2757 4659 \n3358 2838 \n10353 1986 \n"
-		, "0 10353 1986 0 0 161 \n" },
-		{ "2", "9 \n3431 6328 \n4284 2801 \n11141 4590 \n3431 6328 \n4284 2801 \n11141 4590 \n3431 6328 \n4284 2801 \n11141 4590 \n"
-		, "0 11141 4590 0 0 167 \n" },
-		{ "3", "21 \n10892 5399 \n4058 1092 \n6112 2872 \n1961 6027 \n7148 4594 \n7994 1062 \n1711 3942 \n10892 5399 \n4058 1092 \n6112 2872 \n1961 6027 \n7148 4594 \n7994 1062 \n1711 3942 \n10892 5399 \n4058 1092 \n6112 2872 \n1961 6027 \n7148 4594 \n7994 1062 \n1711 3942 \n"
-		, "0 1711 3942 0 0 9 \n" },
-		{ "4", "24 \n1043 1446 \n10158 1241 \n13789 7502 \n7456 3627 \n6218 1993 \n7117 6546 \n5163 7350 \n12603 1090 \n1043 1446 \n10158 1241 \n13789 7502 \n7456 3627 \n6218 1993 \n7117 6546 \n5163 7350 \n12603 1090 \n1043 1446 \n10158 1241 \n13789 7502 \n7456 3627 \n6218 1993 \n7117 6546 \n5163 7350 \n12603 1090 \n"
-		, "0 12603 1090 0 0 178 \n" },
-		{ "5", "24 \n1271 7171 \n14407 3329 \n10949 2136 \n2443 4165 \n5665 6432 \n3079 1942 \n4019 5141 \n9214 6145 \n1271 7171 \n14407 3329 \n10949 2136 \n2443 4165 \n5665 6432 \n3079 1942 \n4019 5141 \n9214 6145 \n1271 7171 \n14407 3329 \n10949 2136 \n2443 4165 \n5665 6432 \n3079 1942 \n4019 5141 \n9214 6145 \n"
-		, "0 9214 6145 0 0 173 \n" },
-		{ "6", "24 \n11727 5704 \n11009 3026 \n10111 1169 \n5835 7503 \n1380 2538 \n4716 1269 \n4025 5146 \n8179 7909 \n11727 5704 \n11009 3026 \n10111 1169 \n5835 7503 \n1380 2538 \n4716 1269 \n4025 5146 \n8179 7909 \n11727 5704 \n11009 3026 \n10111 1169 \n5835 7503 \n1380 2538 \n4716 1269 \n4025 5146 \n8179 7909 \n"
-		, "0 8179 7909 0 0 328 \n" },
-		{ "7", "24 \n14908 1849 \n2485 3249 \n5533 6258 \n12561 1063 \n1589 6883 \n13542 2666 \n13967 6917 \n6910 1656 \n14908 1849 \n2485 3249 \n5533 6258 \n12561 1063 \n1589 6883 \n13542 2666 \n13967 6917 \n6910 1656 \n14908 1849 \n2485 3249 \n5533 6258 \n12561 1063 \n1589 6883 \n13542 2666 \n13967 6917 \n6910 1656 \n"
-		, "0 6910 1656 0 0 1 \n" },
-		{ "8", "24 \n9882 5377 \n3692 3080 \n3562 1207 \n4231 7534 \n14823 6471 \n10974 1853 \n9374 3740 \n4912 4817 \n9882 5377 \n3692 3080 \n3562 1207 \n4231 7534 \n14823 6471 \n10974 1853 \n9374 3740 \n4912 4817 \n9882 5377 \n3692 3080 \n3562 1207 \n4231 7534 \n14823 6471 \n10974 1853 \n9374 3740 \n4912 4817 \n"
-		, "0 4912 4817 0 0 6 \n" },
-		{ "9", "24 \n1271 7171 \n14407 3329 \n10949 2136 \n2443 4165 \n5665 6432 \n3079 1942 \n4019 5141 \n9214 6145 \n1271 7171 \n14407 3329 \n10949 2136 \n2443 4165 \n5665 6432 \n3079 1942 \n4019 5141 \n9214 6145 \n1271 7171 \n14407 3329 \n10949 2136 \n2443 4165 \n5665 6432 \n3079 1942 \n4019 5141 \n9214 6145 \n"
-		, "0 9214 6145 0 0 173 \n" },
-		{ "10", "24 \n9623 7597 \n12512 6231 \n4927 3377 \n8358 6630 \n4459 7216 \n10301 2326 \n2145 3943 \n5674 4795 \n9623 7597 \n12512 6231 \n4927 3377 \n8358 6630 \n4459 7216 \n10301 2326 \n2145 3943 \n5674 4795 \n9623 7597 \n12512 6231 \n4927 3377 \n8358 6630 \n4459 7216 \n10301 2326 \n2145 3943 \n5674 4795 \n"
-		, "0 5674 4795 0 0 35 \n" },
-		{ "11", "24 \n14203 4266 \n3186 5112 \n8012 5958 \n2554 6642 \n5870 4648 \n11089 2403 \n9144 2389 \n12271 7160 \n14203 4266 \n3186 5112 \n8012 5958 \n2554 6642 \n5870 4648 \n11089 2403 \n9144 2389 \n12271 7160 \n14203 4266 \n3186 5112 \n8012 5958 \n2554 6642 \n5870 4648 \n11089 2403 \n9144 2389 \n12271 7160 \n"
-		, "0 12271 7160 0 0 304 \n" },
-		{ "12", "24 \n1779 2501 \n5391 2200 \n13348 4290 \n6144 4176 \n11687 5637 \n14990 3490 \n3569 7566 \n14086 1366 \n1779 2501 \n5391 2200 \n13348 4290 \n6144 4176 \n11687 5637 \n14990 3490 \n3569 7566 \n14086 1366 \n1779 2501 \n5391 2200 \n13348 4290 \n6144 4176 \n11687 5637 \n14990 3490 \n3569 7566 \n14086 1366 \n"
-		, "0 14086 1366 0 0 175 \n" },
-		{ "13", "24 \n6419 7692 \n2099 4297 \n13329 3186 \n13870 7169 \n13469 1115 \n5176 5061 \n1260 7235 \n9302 5289 \n6419 7692 \n2099 4297 \n13329 3186 \n13870 7169 \n13469 1115 \n5176 5061 \n1260 7235 \n9302 5289 \n6419 7692 \n2099 4297 \n13329 3186 \n13870 7169 \n13469 1115 \n5176 5061 \n1260 7235 \n9302 5289 \n"
-		, "0 9302 5289 0 0 140 \n" },
-		{ "14", "24 \n10177 7892 \n5146 7584 \n11531 1216 \n1596 5797 \n8306 3554 \n5814 2529 \n9471 5505 \n6752 5734 \n10177 7892 \n5146 7584 \n11531 1216 \n1596 5797 \n8306 3554 \n5814 2529 \n9471 5505 \n6752 5734 \n10177 7892 \n5146 7584 \n11531 1216 \n1596 5797 \n8306 3554 \n5814 2529 \n9471 5505 \n6752 5734 \n"
-		, "0 6752 5734 0 0 32 \n" },
-		{ "15", "24 \n10312 1696 \n2902 6897 \n5072 7852 \n5918 1004 \n3176 2282 \n14227 2261 \n9986 5567 \n9476 3253 \n10312 1696 \n2902 6897 \n5072 7852 \n5918 1004 \n3176 2282 \n14227 2261 \n9986 5567 \n9476 3253 \n10312 1696 \n2902 6897 \n5072 7852 \n5918 1004 \n3176 2282 \n14227 2261 \n9986 5567 \n9476 3253 \n"
-		, "0 9476 3253 0 0 298 \n" },
-		{ "16", "18 \n12000 1000 \n12500 2500 \n13000 4000 \n12500 5500 \n12000 7000 \n1000 1000 \n12000 1000 \n12500 2500 \n13000 4000 \n12500 5500 \n12000 7000 \n1000 1000 \n12000 1000 \n12500 2500 \n13000 4000 \n12500 5500 \n12000 7000 \n1000 1000 \n"
-		, "0 1000 1000 0 0 0 \n" },
-		{ "17", "24 \n12500 2500 \n12500 5500 \n12000 7000 \n8000 7000 \n7500 5500 \n7500 2500 \n8000 1000 \n12000 1000 \n12500 2500 \n12500 5500 \n12000 7000 \n8000 7000 \n7500 5500 \n7500 2500 \n8000 1000 \n12000 1000 \n12500 2500 \n12500 5500 \n12000 7000 \n8000 7000 \n7500 5500 \n7500 2500 \n8000 1000 \n12000 1000 \n"
-		, "0 12000 1000 0 0 72 \n" },
-		{ "18", "24 \n2500 3905 \n4000 5095 \n5500 3905 \n7000 5095 \n8500 3905 \n10000 5095 \n11500 3905 \n1000 4500 \n2500 3905 \n4000 5095 \n5500 3905 \n7000 5095 \n8500 3905 \n10000 5095 \n11500 3905 \n1000 4500 \n2500 3905 \n4000 5095 \n5500 3905 \n7000 5095 \n8500 3905 \n10000 5095 \n11500 3905 \n1000 4500 \n"
-		, "0 1000 4500 0 0 338 \n" },
-		{ "19", "18 \n15000 8000 \n1000 8000 \n15000 1000 \n1000 4500 \n15000 4500 \n1000 1000 \n15000 8000 \n1000 8000 \n15000 1000 \n1000 4500 \n15000 4500 \n1000 1000 \n15000 8000 \n1000 8000 \n15000 1000 \n1000 4500 \n15000 4500 \n1000 1000 \n"
-		, "0 1000 1000 0 0 27 \n" }
-	};
-	if (m_testParameters)
-		testParameters(inputs);
+	std::vector<GameInput> const& inputs = gameInputs;
+	std::ifstream configFile(configPath);
+	if (configFile)
+	{
+		ASSERT_TRUE(readConfig(configFile, m_config, std::cerr));
+		adjustRuns();
+	}
+	if (m_tuneParameters)
+		tuneParameters(inputs);
 	else
 		runGames(inputs);
 }
@@ -0,0 +1,132 @@
+#pragma once
+
+// Needs the definitions of Main.cpp
+
+#include <deque>
+#include <functional>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#endif
+
+// Pins thread to core where the platform allows it
+static void pinThread(std::thread& thread, Index core)
+{
+#if defined(_WIN32)
+	SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(1) << core);
+#elif defined(__linux__)
+	cpu_set_t cores;
+	CPU_ZERO(&cores);
+	CPU_SET(core, &cores);
+	pthread_setaffinity_np(thread.native_handle(), sizeof(cores), &cores);
+#endif
+}
+
+// Persistent workers, each with its own queue of jobs, an idle worker steals the last job queued to another one
+// Without threads, jobs run as they are submitted
+struct ThreadPool
+{
+	explicit ThreadPool(Count threadsCount, bool pinThreads = false) : m_queues(threadsCount)
+	{
+		auto coresCount = std::max(std::thread::hardware_concurrency(), 1u);
+		for (Index worker = 0; worker < threadsCount; ++worker)
+		{
+			m_threads.emplace_back([this, worker]() { work(worker); });
+			if (pinThreads)
+				pinThread(m_threads.back(), worker % coresCount);
+		}
+	}
+
+	// Jobs already submitted are run before the workers stop
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_available.notify_all();
+		for (auto& thread : m_threads)
+			thread.join();
+	}
+
+	Count getThreadsCount() const
+	{
+		return static_cast<Count>(m_threads.size());
+	}
+
+	void submit(std::function<void()> job)
+	{
+		if (m_threads.empty())
+		{
+			job();
+			return;
+		}
+		auto& queue = m_queues[m_nextQueue++ % m_queues.size()];
+		{
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			queue.m_jobs.push_back(std::move(job));
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			++m_pending;
+		}
+		m_available.notify_one();
+	}
+
+	// A worker takes a job only after reserving it in m_pending, so some queue holds one for it
+	std::function<void()> pop(Index worker)
+	{
+		for (Index offset = 0; true; offset = (offset + 1) % m_queues.size())
+		{
+			auto& queue = m_queues[(worker + offset) % m_queues.size()];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			if (queue.m_jobs.empty())
+				continue;
+			std::function<void()> job;
+			if (!offset)
+			{
+				job = std::move(queue.m_jobs.front());
+				queue.m_jobs.pop_front();
+			}
+			else
+			{
+				job = std::move(queue.m_jobs.back());
+				queue.m_jobs.pop_back();
+			}
+			return job;
+		}
+	}
+
+	void work(Index worker)
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_available.wait(lock, [this]() { return m_stop || m_pending; });
+				if (!m_pending)
+					return;
+				--m_pending;
+			}
+			pop(worker)();
+		}
+	}
+
+	struct Queue
+	{
+		std::mutex m_mutex;
+		std::deque<std::function<void()>> m_jobs;
+	};
+
+	std::vector<Queue> m_queues;
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_available;
+	std::atomic<Index> m_nextQueue = 0;
+	Count m_pending = 0u;
+	bool m_stop = false;
+};
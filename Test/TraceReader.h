@@ -0,0 +1,151 @@
+#pragma once
+
+// Needs the definitions of Main.cpp
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only mapping of a whole file, empty when the file cannot be mapped
+struct MappedFile
+{
+	explicit MappedFile(std::string const& path)
+	{
+#if defined(_WIN32)
+		m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER size;
+		if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size) || !size.QuadPart)
+			return;
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping)
+			return;
+		auto data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data)
+			transfer(m_data, static_cast<char const*>(data), m_size, static_cast<std::size_t>(size.QuadPart));
+#else
+		auto file = open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			return;
+		struct stat status;
+		if (!fstat(file, &status) && status.st_size > 0)
+		{
+			auto data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			if (data != MAP_FAILED)
+				transfer(m_data, static_cast<char const*>(data), m_size, static_cast<std::size_t>(status.st_size));
+		}
+		close(file);
+#endif
+	}
+
+	~MappedFile()
+	{
+#if defined(_WIN32)
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+#else
+		if (m_data)
+			munmap(const_cast<char*>(m_data), m_size);
+#endif
+	}
+
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	char const* m_data = nullptr;
+	std::size_t m_size = 0u;
+#if defined(_WIN32)
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+#endif
+};
+
+// Trace written by runGame with tracePath, its records are read in place from the mapping
+// A trace of another build, whose records have another size, or without its header is invalid
+struct TraceReader
+{
+	explicit TraceReader(std::string const& path) : m_file(path)
+	{
+		if (m_file.m_size < sizeof(TraceHeader))
+			return;
+		std::memcpy(&m_header, m_file.m_data, sizeof(m_header));
+		if (m_header.m_magic != traceMagic || m_header.m_recordSize != sizeof(TraceRecord) || m_file.m_size < m_header.getRecordsOffset())
+			return;
+		m_checkpoints.resize(m_header.m_checkpointsCount);
+		std::memcpy(m_checkpoints.data(), m_file.m_data + sizeof(m_header), m_header.m_checkpointsCount * sizeof(Z));
+		std::istringstream configText(std::string(m_file.m_data + sizeof(m_header) + m_header.m_checkpointsCount * sizeof(Z), m_header.m_configSize));
+		std::ostringstream err;
+		if (!readConfig(configText, m_config, err))
+			return;
+		// A record cut short by the end of the game is left out
+		m_records = reinterpret_cast<TraceRecord const*>(m_file.m_data + m_header.getRecordsOffset());
+		m_recordsCount = (m_file.m_size - m_header.getRecordsOffset()) / sizeof(TraceRecord);
+		m_valid = true;
+	}
+
+	bool isValid() const { return m_valid; }
+	Count getRecordsCount() const { return static_cast<Count>(m_recordsCount); }
+	TraceRecord const& getRecord(Index turn) const { return m_records[turn]; }
+
+	// The game of the trace, as read by runGame from its checkpoints, played with config
+	Game getGame(IO& io, Config const& config) const
+	{
+		std::ostringstream checkpointsText;
+		checkpointsText << m_checkpoints.size() << std::endl;
+		for (auto const& checkpoint : m_checkpoints)
+			checkpointsText << static_cast<int>(checkpoint.real()) << " " << static_cast<int>(checkpoint.imag()) << std::endl;
+		std::istringstream in(checkpointsText.str());
+		IO checkpointsIO{ in, io.m_err, io.m_out };
+		return { config, Checkpoints::read(checkpointsIO, config) };
+	}
+
+	MappedFile m_file;
+	TraceHeader m_header;
+	std::vector<Z> m_checkpoints;
+	Config m_config;
+	TraceRecord const* m_records = nullptr;
+	std::size_t m_recordsCount = 0u;
+	bool m_valid = false;
+};
+
+// Runs the search of the turn again from its recorded inputs and budget, with the recorded virtual clock for a simulation
+// The search of worker 0 is replayed alone, an evolution starts from a new population
+static SearchSlot replayTurn(IO& io, Game const& game, TraceRecord const& record)
+{
+	auto callerClock = virtualClock;
+	virtualClock = { game.m_config.m_simulation ? game.m_config.m_rolloutsPerMillisecond : 0u, record.m_rolloutsCount };
+	auto random = record.m_random;
+	auto targetStep = game.m_checkpoints.m_targetSteps[record.m_state.m_step];
+	std::unique_ptr<Population> population;
+	std::unique_ptr<BeamArena> beamArena;
+	if (game.m_config.m_searchEngine == SearchEngine::Evolution)
+		population = std::make_unique<Population>(game.m_config.m_populationSize);
+	else if (game.m_config.m_searchEngine == SearchEngine::Beam)
+		beamArena = std::make_unique<BeamArena>(game.m_config);
+	SearchSlot slot;
+	transfer(slot.m_best, record.m_initialIteration, slot.m_bestTestSequences, record.m_initialTestSequences);
+	auto limitTimePoint = now() + std::chrono::duration_cast<TimePoint::duration>(std::chrono::nanoseconds(record.m_budget));
+	dispatchPolicy(game.m_config, [&](auto policy)
+	{
+		using Policy = decltype(policy);
+		if (population)
+			searchPopulation<Policy>(io, game, random, *population, record.m_state, targetStep, record.m_initialTestSequences, limitTimePoint, slot);
+		else if (beamArena)
+			searchBeam<Policy>(io, game, *beamArena, record.m_state, targetStep, limitTimePoint, slot);
+		else
+			searchTestSequences<Policy>(io, game, random, record.m_state, targetStep, record.m_initialTestSequences, limitTimePoint, slot);
+	});
+	virtualClock = callerClock;
+	return slot;
+}